@@ -0,0 +1,383 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "chip8.h"
+#include "analyze.h"
+
+// Largest table of JP instructions an indexed jump can reach
+#define CHIP8E_AN_MAX_TABLE 128
+// Pending addresses while following control flow
+#define CHIP8E_AN_WORK_SIZE (2 * CHIP8E_MEM_SIZE)
+
+static uint16_t fetch(const uint8_t *memory, uint16_t addr)
+{
+    return memory[CHIP8E_MEM_MASK(addr)] << 8 | memory[CHIP8E_MEM_MASK(addr + 1)];
+}
+
+// Classify the instruction at addr. Returns true if it ends a basic
+// block, with the flow kind and successors filled in.
+static bool classify(uint16_t cmd, uint16_t addr, chip8_flow_t *flow, uint16_t succ[2])
+{
+    // PC wraps around the end of memory like in chip8_cycle()
+    uint16_t next = CHIP8E_MEM_MASK(addr + 2);
+    succ[0] = succ[1] = CHIP8E_AN_NONE;
+
+    switch (CHIP8_INSTR_CMD(cmd)) {
+        case 0x0:
+            if (0x00EE == cmd) {
+                *flow = CHIP8E_FLOW_RET;
+                return true;
+            }
+        break;
+        case 0x1:
+            if (CHIP8_INSTR_ADDR(cmd) == addr) {
+                *flow = CHIP8E_FLOW_HALT;
+            } else {
+                *flow = CHIP8E_FLOW_JUMP;
+                succ[0] = CHIP8_INSTR_ADDR(cmd);
+            }
+            return true;
+        case 0x2:
+            *flow = CHIP8E_FLOW_CALL;
+            succ[0] = CHIP8_INSTR_ADDR(cmd);
+            succ[1] = next;
+            return true;
+        case 0x3:
+        case 0x4:
+        case 0x5:
+        case 0x9:
+            *flow = CHIP8E_FLOW_SKIP;
+            succ[0] = CHIP8E_MEM_MASK(addr + 4);
+            succ[1] = next;
+            return true;
+        case 0x8:
+            switch (CHIP8_INSTR_NIBBLE(cmd)) {
+                case 0x0: case 0x1: case 0x2: case 0x3:
+                case 0x4: case 0x5: case 0x6: case 0x7:
+                case 0xE:
+                break;
+                default:
+                    *flow = CHIP8E_FLOW_INVALID;
+                    return true;
+            }
+        break;
+        case 0xB:
+            *flow = CHIP8E_FLOW_INDIRECT;
+            succ[0] = CHIP8_INSTR_ADDR(cmd);
+            return true;
+        case 0xE:
+            if (0x9E == CHIP8_INSTR_BYTE(cmd) || 0xA1 == CHIP8_INSTR_BYTE(cmd)) {
+                *flow = CHIP8E_FLOW_SKIP;
+                succ[0] = CHIP8E_MEM_MASK(addr + 4);
+                succ[1] = next;
+            } else {
+                *flow = CHIP8E_FLOW_INVALID;
+            }
+            return true;
+        case 0xF:
+            switch (CHIP8_INSTR_BYTE(cmd)) {
+                case 0x07: case 0x0A: case 0x15: case 0x18: case 0x1E:
+                case 0x29: case 0x33: case 0x55: case 0x65:
+                break;
+                default:
+                    *flow = CHIP8E_FLOW_INVALID;
+                    return true;
+            }
+        break;
+        default:
+        break;
+    }
+    *flow = CHIP8E_FLOW_FALL;
+    succ[0] = next;
+    return false;
+}
+
+int chip8_jump_table(const uint8_t *memory, uint16_t base, uint16_t *entries)
+{
+    int n = 0;
+    base = CHIP8E_MEM_MASK(base);
+    for (uint16_t a = base; n < CHIP8E_AN_MAX_TABLE && a < CHIP8E_MEM_SIZE; a += 2) {
+        if (CHIP8_INSTR_CMD(fetch(memory, a)) != 0x1)
+            break;
+        entries[n++] = a;
+    }
+    // Not a table of jumps, at least V0 = 0 lands on base
+    if (0 == n)
+        entries[n++] = base;
+    return n;
+}
+
+static void mark_target(chip8_analysis_p an, uint16_t *work, int *top, uint16_t addr, uint8_t flags)
+{
+    addr = CHIP8E_MEM_MASK(addr);
+    an->flags[addr] |= CHIP8E_AN_LEADER | flags;
+    if (!(an->flags[addr] & CHIP8E_AN_CODE) && *top < CHIP8E_AN_WORK_SIZE)
+        work[(*top)++] = addr;
+}
+
+void chip8_analyze(chip8_analysis_p an, const uint8_t *memory, uint16_t end)
+{
+    static uint16_t work[CHIP8E_AN_WORK_SIZE];
+    uint16_t table[CHIP8E_AN_MAX_TABLE];
+    int top = 0;
+
+    memset(an->flags, 0x00, sizeof(an->flags));
+    an->end = (end > CHIP8E_MEM_SIZE) ? CHIP8E_MEM_SIZE : end;
+    an->block_count = 0;
+
+    mark_target(an, work, &top, CHIP8E_MEM_OFFSET_PROGRAM_START, 0);
+
+    // Follow control flow, marking reachable instructions
+    while (top > 0) {
+        uint16_t addr = work[--top];
+        bool ends = false;
+
+        while (!ends && !(an->flags[addr] & CHIP8E_AN_CODE)) {
+            chip8_flow_t flow;
+            uint16_t succ[2];
+            uint16_t cmd = fetch(memory, addr);
+
+            an->flags[addr] |= CHIP8E_AN_CODE;
+            an->flags[CHIP8E_MEM_MASK(addr + 1)] |= CHIP8E_AN_OPERAND;
+            if (CHIP8_INSTR_CMD(cmd) == 0xA)
+                an->flags[CHIP8_INSTR_ADDR(cmd)] |= CHIP8E_AN_DATA_REF;
+
+            ends = classify(cmd, addr, &flow, succ);
+            switch (flow) {
+                case CHIP8E_FLOW_FALL:
+                    addr = succ[0];
+                break;
+                case CHIP8E_FLOW_JUMP:
+                    mark_target(an, work, &top, succ[0], CHIP8E_AN_TARGET);
+                break;
+                case CHIP8E_FLOW_CALL:
+                    mark_target(an, work, &top, succ[0], CHIP8E_AN_TARGET | CHIP8E_AN_SUB);
+                    mark_target(an, work, &top, succ[1], 0);
+                break;
+                case CHIP8E_FLOW_SKIP:
+                    mark_target(an, work, &top, succ[0], 0);
+                    mark_target(an, work, &top, succ[1], 0);
+                break;
+                case CHIP8E_FLOW_INDIRECT: {
+                    int n = chip8_jump_table(memory, succ[0], table);
+                    for (int i = 0; i < n; i++)
+                        mark_target(an, work, &top, table[i], CHIP8E_AN_TARGET);
+                }
+                break;
+                default:
+                break;
+            }
+        }
+    }
+
+    // Cut the reachable instructions into basic blocks
+    for (uint16_t addr = 0; addr < CHIP8E_MEM_SIZE; addr++) {
+        if (!(an->flags[addr] & CHIP8E_AN_LEADER) || !(an->flags[addr] & CHIP8E_AN_CODE))
+            continue;
+
+        chip8_block_t *b = &an->blocks[an->block_count++];
+        uint16_t a = addr;
+        b->start = addr;
+        for (;;) {
+            bool ends = classify(fetch(memory, a), a, &b->flow, b->succ);
+            b->last = a;
+            if (ends)
+                break;
+            a = b->succ[0];
+            if ((an->flags[a] & CHIP8E_AN_LEADER) || !(an->flags[a] & CHIP8E_AN_CODE))
+                break;
+        }
+        b->end = b->last + 2;
+        if (an->block_count == CHIP8E_AN_MAX_BLOCKS)
+            break;
+    }
+}
+
+int chip8_analysis_block_at(chip8_analysis_p an, uint16_t addr)
+{
+    int lo = 0, hi = an->block_count - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (an->blocks[mid].start == addr)
+            return mid;
+        if (an->blocks[mid].start < addr)
+            lo = mid + 1;
+        else
+            hi = mid - 1;
+    }
+    return -1;
+}
+
+void chip8_disasm(uint16_t cmd, char *buf, size_t len)
+{
+    uint8_t x = CHIP8_INSTR_R1(cmd);
+    uint8_t y = CHIP8_INSTR_R2(cmd);
+    uint8_t b = CHIP8_INSTR_BYTE(cmd);
+    uint16_t addr = CHIP8_INSTR_ADDR(cmd);
+
+    switch (CHIP8_INSTR_CMD(cmd)) {
+        case 0x0:
+            if (0x00E0 == cmd)
+                snprintf(buf, len, "CLS");
+            else if (0x00EE == cmd)
+                snprintf(buf, len, "RET ");
+            else
+                snprintf(buf, len, "SYS  %04x", addr);
+        return;
+        case 0x1: snprintf(buf, len, "JP   %04x", addr); return;
+        case 0x2: snprintf(buf, len, "CALL %04x", addr); return;
+        case 0x3: snprintf(buf, len, "SE   V%02X %02x", x, b); return;
+        case 0x4: snprintf(buf, len, "SNE  V%02X %02x", x, b); return;
+        case 0x5: snprintf(buf, len, "SE   V%02X V%02X", x, y); return;
+        case 0x6: snprintf(buf, len, "LD   V%02X %02x", x, b); return;
+        case 0x7: snprintf(buf, len, "ADD  V%02X %02x", x, b); return;
+        case 0x8:
+            switch (CHIP8_INSTR_NIBBLE(cmd)) {
+                case 0x0: snprintf(buf, len, "LD   V%02X V%02X", x, y); return;
+                case 0x1: snprintf(buf, len, "OR   V%02X V%02X", x, y); return;
+                case 0x2: snprintf(buf, len, "AND  V%02X V%02X", x, y); return;
+                case 0x3: snprintf(buf, len, "XOR  V%02X V%02X", x, y); return;
+                case 0x4: snprintf(buf, len, "ADD  V%02X V%02X", x, y); return;
+                case 0x5: snprintf(buf, len, "SUB  V%02X V%02X", x, y); return;
+                case 0x6: snprintf(buf, len, "SHR  V%02X", x); return;
+                case 0x7: snprintf(buf, len, "SUBN V%02X V%02X", x, y); return;
+                case 0xE: snprintf(buf, len, "SHL  V%02X", x); return;
+            }
+        break;
+        case 0x9: snprintf(buf, len, "SNE  V%02X V%02X", x, y); return;
+        case 0xA: snprintf(buf, len, "LDI  %04x", addr); return;
+        case 0xB: snprintf(buf, len, "JP   V0 %04x", addr); return;
+        case 0xC: snprintf(buf, len, "RND  V%02X %02x", x, b); return;
+        case 0xD: snprintf(buf, len, "DRW  V%02X V%02X %02x", x, y, CHIP8_INSTR_NIBBLE(cmd)); return;
+        case 0xE:
+            switch (b) {
+                case 0x9E: snprintf(buf, len, "SKP  V%02X", x); return;
+                case 0xA1: snprintf(buf, len, "SKNP V%02X", x); return;
+            }
+        break;
+        case 0xF:
+            switch (b) {
+                case 0x07: snprintf(buf, len, "LD   V%02X DT", x); return;
+                case 0x0A: snprintf(buf, len, "LD   V%02X K", x); return;
+                case 0x15: snprintf(buf, len, "LD   DT V%02X", x); return;
+                case 0x18: snprintf(buf, len, "LD   ST V%02X", x); return;
+                case 0x1E: snprintf(buf, len, "ADD  I V%02X", x); return;
+                case 0x29: snprintf(buf, len, "LD   F V%02X", x); return;
+                case 0x33: snprintf(buf, len, "LD   B V%02X", x); return;
+                case 0x55: snprintf(buf, len, "LD   [I] V%02X", x); return;
+                case 0x65: snprintf(buf, len, "LD   V%02X [I]", x); return;
+            }
+        break;
+    }
+    snprintf(buf, len, "DW   %04x", cmd);
+}
+
+void chip8_analysis_listing(chip8_analysis_p an, const uint8_t *memory, FILE *out)
+{
+    char text[32];
+    uint16_t end = an->end;
+
+    // Reachable code may extend past the loaded image
+    for (int a = CHIP8E_MEM_SIZE - 1; a >= end; a--) {
+        if (an->flags[a] & (CHIP8E_AN_CODE | CHIP8E_AN_OPERAND)) {
+            end = a + 1;
+            break;
+        }
+    }
+
+    uint16_t addr = CHIP8E_MEM_OFFSET_PROGRAM_START;
+    while (addr < end) {
+        uint8_t f = an->flags[addr];
+
+        if (f & CHIP8E_AN_CODE) {
+            if (f & CHIP8E_AN_LEADER)
+                fprintf(out, "\n");
+            if (f & CHIP8E_AN_SUB)
+                fprintf(out, "; subroutine\n");
+            if (f & CHIP8E_AN_TARGET)
+                fprintf(out, "L%04X:\n", addr);
+            uint16_t cmd = fetch(memory, addr);
+            chip8_disasm(cmd, text, sizeof(text));
+            fprintf(out, "%04X: %04x  %s\n", addr, cmd, text);
+            addr += 2;
+            continue;
+        }
+
+        // Data runs up to the next instruction or data label, 8 per line
+        if (f & CHIP8E_AN_DATA_REF)
+            fprintf(out, "D%04X:\n", addr);
+        fprintf(out, "%04X: DB  ", addr);
+        int n = 0;
+        do {
+            fprintf(out, " %02x", memory[addr]);
+            addr++;
+            n++;
+        } while (n < 8 && addr < end &&
+            !(an->flags[addr] & (CHIP8E_AN_CODE | CHIP8E_AN_DATA_REF)));
+        fprintf(out, "\n");
+    }
+}
+
+static void dot_edge(FILE *out, uint16_t from, uint16_t to, const char *attr)
+{
+    if (to != CHIP8E_AN_NONE)
+        fprintf(out, "    b%04X -> b%04X [%s];\n", from, to, attr);
+}
+
+void chip8_analysis_dot(chip8_analysis_p an, const uint8_t *memory, FILE *out)
+{
+    static const char *flow_names[] = {
+        [CHIP8E_FLOW_FALL] = "fall",
+        [CHIP8E_FLOW_JUMP] = "jump",
+        [CHIP8E_FLOW_SKIP] = "skip",
+        [CHIP8E_FLOW_CALL] = "call",
+        [CHIP8E_FLOW_RET] = "ret",
+        [CHIP8E_FLOW_INDIRECT] = "indirect",
+        [CHIP8E_FLOW_HALT] = "halt",
+        [CHIP8E_FLOW_INVALID] = "invalid"
+    };
+    uint16_t table[CHIP8E_AN_MAX_TABLE];
+    char text[32];
+
+    fprintf(out, "digraph chip8 {\n");
+    fprintf(out, "    node [shape=box, fontname=\"monospace\"];\n");
+
+    for (int i = 0; i < an->block_count; i++) {
+        chip8_block_t *b = &an->blocks[i];
+
+        fprintf(out, "    b%04X [label=\"", b->start);
+        for (uint16_t a = b->start; a <= b->last; a += 2) {
+            chip8_disasm(fetch(memory, a), text, sizeof(text));
+            fprintf(out, "%04X: %s\\l", a, text);
+        }
+        fprintf(out, "; %s\\l\"%s];\n", flow_names[b->flow],
+            (an->flags[b->start] & CHIP8E_AN_SUB) ? ", style=bold" : "");
+
+        switch (b->flow) {
+            case CHIP8E_FLOW_FALL:
+            case CHIP8E_FLOW_JUMP:
+                dot_edge(out, b->start, b->succ[0], "");
+            break;
+            case CHIP8E_FLOW_SKIP:
+                dot_edge(out, b->start, b->succ[0], "label=\"skip\"");
+                dot_edge(out, b->start, b->succ[1], "label=\"next\"");
+            break;
+            case CHIP8E_FLOW_CALL:
+                dot_edge(out, b->start, b->succ[0], "label=\"call\", style=dashed");
+                dot_edge(out, b->start, b->succ[1], "label=\"return\"");
+            break;
+            case CHIP8E_FLOW_INDIRECT: {
+                int n = chip8_jump_table(memory, b->succ[0], table);
+                for (int t = 0; t < n; t++)
+                    dot_edge(out, b->start, table[t], "style=dotted");
+            }
+            break;
+            default:
+            break;
+        }
+    }
+    fprintf(out, "}\n");
+}
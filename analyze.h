@@ -0,0 +1,78 @@
+#ifndef __ANALYZE_H
+#define __ANALYZE_H
+
+#include "chip8.h"
+
+/**
+ * Static analysis of a program image.
+ *
+ * Code is found by following control flow from the program start:
+ * jumps, calls, returns and skips. Everything in the program area that
+ * flow never reaches is treated as data. Indexed jumps (Bnnn) are
+ * resolved by assuming a table of JP instructions at nnn.
+ *
+ * The result is a per-address flag map and the list of basic blocks,
+ * which can be printed as an annotated listing or a CFG in DOT format,
+ * or used to prepare caches before the program runs.
+ **/
+
+// Per-address flags
+#define CHIP8E_AN_CODE     0x01  // first byte of a reachable instruction
+#define CHIP8E_AN_OPERAND  0x02  // second byte of a reachable instruction
+#define CHIP8E_AN_LEADER   0x04  // starts a basic block
+#define CHIP8E_AN_TARGET   0x08  // target of JP, CALL or Bnnn
+#define CHIP8E_AN_SUB      0x10  // target of CALL
+#define CHIP8E_AN_DATA_REF 0x20  // loaded into I by LD I, nnn
+
+// How a basic block ends
+typedef enum {
+    CHIP8E_FLOW_FALL,      // falls into the next leader
+    CHIP8E_FLOW_JUMP,      // JP nnn
+    CHIP8E_FLOW_SKIP,      // conditional skip, next or the one after
+    CHIP8E_FLOW_CALL,      // CALL nnn, resumes after the call
+    CHIP8E_FLOW_RET,       // RET
+    CHIP8E_FLOW_INDIRECT,  // JP V0, nnn
+    CHIP8E_FLOW_HALT,      // JP to itself
+    CHIP8E_FLOW_INVALID    // unknown opcode or end of memory
+} chip8_flow_t;
+
+// No successor
+#define CHIP8E_AN_NONE 0xFFFF
+
+// Every block holds at least one 2 byte instruction
+#define CHIP8E_AN_MAX_BLOCKS (CHIP8E_MEM_SIZE / 2)
+
+typedef struct {
+    // Address range [start, end)
+    uint16_t start, end;
+    // Address of the last instruction
+    uint16_t last;
+    chip8_flow_t flow;
+    // Successors, taken branch first, CHIP8E_AN_NONE when absent
+    uint16_t succ[2];
+} chip8_block_t;
+
+typedef struct {
+    uint8_t flags[CHIP8E_MEM_SIZE];
+    // End of the program image
+    uint16_t end;
+    uint16_t block_count;
+    chip8_block_t blocks[CHIP8E_AN_MAX_BLOCKS];
+} chip8_analysis_t, *chip8_analysis_p;
+
+// Analyze the program in memory[CHIP8E_MEM_OFFSET_PROGRAM_START, end)
+void chip8_analyze(chip8_analysis_p an, const uint8_t *memory, uint16_t end);
+// Index of the block starting at addr, -1 if none does
+int chip8_analysis_block_at(chip8_analysis_p an, uint16_t addr);
+// Annotated disassembly, data bytes are listed as DB
+void chip8_analysis_listing(chip8_analysis_p an, const uint8_t *memory, FILE *out);
+// Control flow graph in DOT format
+void chip8_analysis_dot(chip8_analysis_p an, const uint8_t *memory, FILE *out);
+// Entries of the JP table an indexed jump to base is assumed to use,
+// entries must have room for 128 addresses
+int chip8_jump_table(const uint8_t *memory, uint16_t base, uint16_t *entries);
+
+// Mnemonic for cmd, in the format of the instruction traces
+void chip8_disasm(uint16_t cmd, char *buf, size_t len);
+
+#endif // __ANALYZE_H
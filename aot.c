@@ -0,0 +1,296 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "chip8.h"
+#include "analyze.h"
+#include "aot.h"
+
+static uint16_t fetch(const uint8_t *memory, uint16_t addr)
+{
+    return memory[CHIP8E_MEM_MASK(addr)] << 8 | memory[CHIP8E_MEM_MASK(addr + 1)];
+}
+
+static bool is_store(uint16_t cmd)
+{
+    return CHIP8_INSTR_CMD(cmd) == 0xF &&
+        (CHIP8_INSTR_BYTE(cmd) == 0x33 || CHIP8_INSTR_BYTE(cmd) == 0x55);
+}
+
+// Hand the instruction to the interpreter, it advances PC itself
+static void emit_core(FILE *out, uint16_t addr, uint16_t cmd)
+{
+    fprintf(out, "    chip->PC = 0x%03X;\n", addr);
+    fprintf(out, "    chip8_interpret_cmd(chip, 0x%04X);\n", cmd);
+}
+
+// Emit an instruction that does not end its block. retired is the number
+// of instructions of the block before it, for the early exits.
+static void emit_plain(FILE *out, uint16_t addr, uint16_t cmd, int retired)
+{
+    unsigned x = CHIP8_INSTR_R1(cmd);
+    unsigned y = CHIP8_INSTR_R2(cmd);
+    unsigned b = CHIP8_INSTR_BYTE(cmd);
+    unsigned nnn = CHIP8_INSTR_ADDR(cmd);
+    char text[32];
+
+    chip8_disasm(cmd, text, sizeof(text));
+    fprintf(out, "    // %04X: %s\n", addr, text);
+
+    switch (CHIP8_INSTR_CMD(cmd)) {
+        case 0x6:
+            fprintf(out, "    V[0x%X] = 0x%02X;\n", x, b);
+        return;
+        case 0x7:
+            fprintf(out, "    V[0x%X] += 0x%02X;\n", x, b);
+        return;
+        case 0x8:
+            switch (CHIP8_INSTR_NIBBLE(cmd)) {
+                case 0x0:
+                    fprintf(out, "    V[0x%X] = V[0x%X];\n", x, y);
+                return;
+                case 0x1:
+                    fprintf(out, "    V[0x%X] |= V[0x%X];\n", x, y);
+                return;
+                case 0x2:
+                    fprintf(out, "    V[0x%X] &= V[0x%X];\n", x, y);
+                return;
+                case 0x3:
+                    fprintf(out, "    V[0x%X] ^= V[0x%X];\n", x, y);
+                return;
+                // Flag first, then the result, as in the interpreter
+                case 0x4:
+                    fprintf(out, "    V[VF] = (V[0x%X] + V[0x%X] > 0xFF) ? 1 : 0;\n", x, y);
+                    fprintf(out, "    V[0x%X] += V[0x%X];\n", x, y);
+                return;
+                case 0x5:
+                    fprintf(out, "    V[VF] = (V[0x%X] > V[0x%X]) ? 1 : 0;\n", x, y);
+                    fprintf(out, "    V[0x%X] -= V[0x%X];\n", x, y);
+                return;
+                case 0x6:
+                    fprintf(out, "    V[VF] = V[0x%X] & CHIP8_ENDIAN_MASK_LSB;\n", x);
+                    fprintf(out, "    V[0x%X] >>= 1;\n", x);
+                return;
+                case 0x7:
+                    fprintf(out, "    V[VF] = (V[0x%X] > V[0x%X]) ? 1 : 0;\n", y, x);
+                    fprintf(out, "    V[0x%X] = V[0x%X] - V[0x%X];\n", x, y, x);
+                return;
+                case 0xE:
+                    fprintf(out, "    V[VF] = V[0x%X] & CHIP8_ENDIAN_MASK_MSB;\n", x);
+                    fprintf(out, "    V[0x%X] <<= 1;\n", x);
+                return;
+            }
+        break;
+        case 0xA:
+            fprintf(out, "    chip->I = 0x%03X;\n", nnn);
+        return;
+        case 0xF:
+            switch (b) {
+                case 0x07:
+                    fprintf(out, "    V[0x%X] = chip->DT;\n", x);
+                return;
+                case 0x15:
+                    fprintf(out, "    chip->DT = V[0x%X];\n", x);
+                return;
+                case 0x18:
+                    fprintf(out, "    chip->ST = V[0x%X];\n", x);
+                return;
+                case 0x1E:
+                    fprintf(out, "    chip->I = CHIP8E_MEM_MASK(chip->I + V[0x%X]);\n", x);
+                return;
+                case 0x29:
+                    fprintf(out, "    chip->I = CHIP8E_MEM_OFFSET_SPRITE_START + CHIP8E_REG_MASK(V[0x%X]) * 5;\n", x);
+                return;
+                case 0x65:
+                    fprintf(out, "    for (int i = 0; i <= 0x%X; i++)\n", x);
+                    fprintf(out, "        V[i] = chip->memory[CHIP8E_MEM_MASK(chip->I + i)];\n");
+                return;
+                case 0x0A:
+                    // Waiting for a key leaves PC here, the interpreter
+                    // keeps polling until one is pressed
+                    emit_core(out, addr, cmd);
+                    fprintf(out, "    if (chip->PC == 0x%03X) {\n", addr);
+                    fprintf(out, "        chip->instructions += %d;\n", retired + 1);
+                    fprintf(out, "        return;\n");
+                    fprintf(out, "    }\n");
+                return;
+            }
+        break;
+    }
+
+    // CLS, SYS, RND, DRW and the stores
+    emit_core(out, addr, cmd);
+    if (is_store(cmd)) {
+        fprintf(out, "    if (chip8_aot_store(rt, chip, 0x%04X)) {\n", cmd);
+        fprintf(out, "        chip->instructions += %d;\n", retired + 1);
+        fprintf(out, "        return;\n");
+        fprintf(out, "    }\n");
+    }
+}
+
+// Emit the instruction that ends a block, it sets the next PC
+static void emit_exit(FILE *out, chip8_block_t *blk, uint16_t addr, uint16_t cmd)
+{
+    unsigned x = CHIP8_INSTR_R1(cmd);
+    unsigned y = CHIP8_INSTR_R2(cmd);
+    unsigned b = CHIP8_INSTR_BYTE(cmd);
+    unsigned nnn = CHIP8_INSTR_ADDR(cmd);
+    unsigned next = CHIP8E_MEM_MASK(addr + 2);
+    unsigned skip = CHIP8E_MEM_MASK(addr + 4);
+    char text[32];
+
+    chip8_disasm(cmd, text, sizeof(text));
+    fprintf(out, "    // %04X: %s\n", addr, text);
+
+    switch (blk->flow) {
+        case CHIP8E_FLOW_JUMP:
+        case CHIP8E_FLOW_HALT:
+            fprintf(out, "    chip->PC = 0x%03X;\n", nnn);
+        return;
+        case CHIP8E_FLOW_CALL:
+        case CHIP8E_FLOW_RET:
+            // A full or empty stack traps with PC on the instruction
+            emit_core(out, addr, cmd);
+        return;
+        case CHIP8E_FLOW_INDIRECT:
+            fprintf(out, "    chip->PC = CHIP8E_MEM_MASK(V[V0] + 0x%03X);\n", nnn);
+        return;
+        case CHIP8E_FLOW_SKIP:
+            switch (CHIP8_INSTR_CMD(cmd)) {
+                case 0x3:
+                    fprintf(out, "    chip->PC = (V[0x%X] == 0x%02X) ? 0x%03X : 0x%03X;\n", x, b, skip, next);
+                return;
+                case 0x4:
+                    fprintf(out, "    chip->PC = (V[0x%X] != 0x%02X) ? 0x%03X : 0x%03X;\n", x, b, skip, next);
+                return;
+                case 0x5:
+                    fprintf(out, "    chip->PC = (V[0x%X] == V[0x%X]) ? 0x%03X : 0x%03X;\n", x, y, skip, next);
+                return;
+                case 0x9:
+                    fprintf(out, "    chip->PC = (V[0x%X] != V[0x%X]) ? 0x%03X : 0x%03X;\n", x, y, skip, next);
+                return;
+            }
+            // SKP and SKNP read the keypad
+            emit_core(out, addr, cmd);
+        return;
+        default:
+            // Unknown opcodes raise the exception in the interpreter
+            emit_core(out, addr, cmd);
+        return;
+    }
+}
+
+void chip8_aot_emit(chip8_analysis_p an, const uint8_t *memory, FILE *out)
+{
+    uint16_t start = CHIP8E_MEM_OFFSET_PROGRAM_START;
+    uint16_t end = an->end;
+
+    // The image covers every translated instruction
+    for (int i = 0; i < an->block_count; i++) {
+        chip8_block_t *blk = &an->blocks[i];
+        if (blk->start < start)
+            start = blk->start;
+        if (blk->end > end)
+            end = (blk->end > CHIP8E_MEM_SIZE) ? CHIP8E_MEM_SIZE : blk->end;
+    }
+
+    fprintf(out, "// Generated by chip8e-aot, do not edit.\n");
+    fprintf(out, "#include \"aot.h\"\n\n");
+    fprintf(out, "#define V (chip->V)\n\n");
+
+    fprintf(out, "static const uint8_t image[] = {");
+    for (int a = start; a < end; a++)
+        fprintf(out, "%s0x%02X,", ((a - start) % 12) ? " " : "\n    ", memory[a]);
+    fprintf(out, "\n};\n");
+
+    for (int i = 0; i < an->block_count; i++) {
+        chip8_block_t *blk = &an->blocks[i];
+        int retired = 0;
+
+        fprintf(out, "\nstatic void b_%04X(chip8_p chip, chip8_aot_p rt)\n{\n", blk->start);
+        for (uint16_t a = blk->start; ; a = CHIP8E_MEM_MASK(a + 2)) {
+            uint16_t cmd = fetch(memory, a);
+            if (a != blk->last || blk->flow == CHIP8E_FLOW_FALL)
+                emit_plain(out, a, cmd, retired);
+            else
+                emit_exit(out, blk, a, cmd);
+            retired++;
+            if (a == blk->last)
+                break;
+        }
+        if (blk->flow == CHIP8E_FLOW_FALL)
+            fprintf(out, "    chip->PC = 0x%03X;\n", blk->succ[0]);
+        fprintf(out, "    chip->instructions += %d;\n}\n", retired);
+    }
+
+    fprintf(out, "\nstatic const chip8_aot_range_t ranges[] = {\n");
+    for (int i = 0; i < an->block_count; i++)
+        fprintf(out, "    { 0x%03X, 0x%03X },\n", an->blocks[i].start, an->blocks[i].end);
+    fprintf(out, "};\n");
+
+    fprintf(out, "\nstatic const chip8_aot_block_fn blocks[] = {\n");
+    for (int i = 0; i < an->block_count; i++)
+        fprintf(out, "    b_%04X,\n", an->blocks[i].start);
+    fprintf(out, "};\n");
+
+    fprintf(out, "\nconst chip8_aot_program_t chip8_aot_program = {\n");
+    fprintf(out, "    0x%03X, 0x%03X, image, %d, ranges, blocks\n};\n",
+        start, end, an->block_count);
+}
+
+int chip8_aot_init(chip8_aot_p rt, const chip8_aot_program_t *prog, chip8_p chip)
+{
+    if (memcmp(chip->memory + prog->start, prog->image, prog->end - prog->start)) {
+        printf("Memory does not hold the translated program.\n");
+        return EXIT_FAILURE;
+    }
+
+    rt->prog = prog;
+    memset(rt->table, 0x00, sizeof(rt->table));
+    for (int i = 0; i < prog->block_count; i++)
+        rt->table[prog->ranges[i].start] = prog->blocks[i];
+    return EXIT_SUCCESS;
+}
+
+bool chip8_aot_store(chip8_aot_p rt, chip8_p chip, uint16_t cmd)
+{
+    const chip8_aot_program_t *prog = rt->prog;
+    int n = (CHIP8_INSTR_BYTE(cmd) == 0x33) ? 3 : CHIP8_INSTR_R1(cmd) + 1;
+    bool dropped = false;
+
+    for (int i = 0; i < n; i++) {
+        uint16_t a = CHIP8E_MEM_MASK(chip->I + i);
+        if (a < prog->start || a >= prog->end)
+            continue;
+        if (chip->memory[a] == prog->image[a - prog->start])
+            continue;
+        for (int r = 0; r < prog->block_count; r++) {
+            const chip8_aot_range_t *range = &prog->ranges[r];
+            if (range->start <= a && a < range->end && rt->table[range->start]) {
+                rt->table[range->start] = NULL;
+                dropped = true;
+            }
+        }
+    }
+    return dropped;
+}
+
+uint64_t chip8_aot_run(chip8_aot_p rt, chip8_p chip, uint64_t budget)
+{
+    uint64_t first = chip->instructions;
+
+    while (chip->state == CHIP_STATE_NORMAL && chip->instructions - first < budget) {
+        chip->PC = CHIP8E_MEM_MASK(chip->PC);
+        chip8_aot_block_fn block = rt->table[chip->PC];
+        if (block) {
+            block(chip, rt);
+        } else {
+            chip8_cycle(chip);
+            if (is_store(chip->opcode))
+                chip8_aot_store(rt, chip, chip->opcode);
+        }
+    }
+    return chip->instructions - first;
+}
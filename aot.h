@@ -0,0 +1,61 @@
+#ifndef __AOT_H
+#define __AOT_H
+
+#include "chip8.h"
+#include "stack.h"
+#include "analyze.h"
+
+/**
+ * Ahead of time translation of a program to C.
+ *
+ * chip8_aot_emit() writes a C file with one function per basic block
+ * found by the analyzer and a PC indexed table of them, which is how
+ * indexed jumps (Bnnn) and RET find their target. Register arithmetic is
+ * translated inline; DRW, keypad, RND and the memory stores call into
+ * chip8_interpret_cmd().
+ *
+ * chip8_aot_run() dispatches through the table and runs addresses
+ * without a translated block on the interpreter. A store that changes a
+ * translated instruction drops the blocks covering it from the table,
+ * from then on that code runs on the interpreter too.
+ **/
+
+struct chip8_aot;
+typedef void (*chip8_aot_block_fn)(chip8_p chip, struct chip8_aot *rt);
+
+typedef struct {
+    uint16_t start, end;
+} chip8_aot_range_t;
+
+// What a generated file exports as chip8_aot_program
+typedef struct {
+    // Program image the code was translated from, [start, end)
+    uint16_t start, end;
+    const uint8_t *image;
+    uint16_t block_count;
+    const chip8_aot_range_t *ranges;
+    const chip8_aot_block_fn *blocks;
+} chip8_aot_program_t;
+
+// Defined by the generated file
+extern const chip8_aot_program_t chip8_aot_program;
+
+typedef struct chip8_aot {
+    const chip8_aot_program_t *prog;
+    // Block for each PC, NULL runs the interpreter
+    chip8_aot_block_fn table[CHIP8E_MEM_SIZE];
+} chip8_aot_t, *chip8_aot_p;
+
+// Write the translation of the analyzed program to out
+void chip8_aot_emit(chip8_analysis_p an, const uint8_t *memory, FILE *out);
+
+// Prepare the dispatch table, fails if memory does not hold the image
+int chip8_aot_init(chip8_aot_p rt, const chip8_aot_program_t *prog, chip8_p chip);
+// Run at least budget instructions, or until the machine leaves the
+// normal state. Returns the number of instructions retired.
+uint64_t chip8_aot_run(chip8_aot_p rt, chip8_p chip, uint64_t budget);
+// Called after a store instruction, drops the blocks it overwrote.
+// Returns true if any were, the calling block must then return.
+bool chip8_aot_store(chip8_aot_p rt, chip8_p chip, uint16_t cmd);
+
+#endif // __AOT_H
@@ -13,30 +13,44 @@
 #include "chip8.h"
 #include "stack.h"
 #include "sprites.h"
+#include "debug.h"
+#include "fuse.h"
+#include "timing.h"
+#include "watchdog.h"
+#include "probes.h"
 #include "instructions.h"
 
 void chip8_init(chip8_p chip)
 {
-    srand(time(NULL));
+    chip->seed = time(NULL);
     chip->state = CHIP_STATE_NORMAL;
     chip8_stack_init(chip);
     // registers
     for (int i = 0; i < 16; i++) {
         chip->V[i] = 0;
     }
+    chip->I = 0;
+    chip->DT = 0;
+    chip->ST = 0;
+    chip->keys = 0;
+    chip->opcode = 0;
+    chip->debug = NULL;
+    chip->fusion = NULL;
+    chip->watchdog = NULL;
+    chip->instructions = 0;
+    memset(chip->video_buffer, 0x00, sizeof(chip->video_buffer));
     // memory
     for (int i = 0; i < CHIP8E_MEM_SIZE; i++) {
         chip->memory[i] = CHIP8_EMPTY_BYTE;
     }
-    chip->cmd_delay_ts.tv_sec = CHIP8E_CMD_TS_DELAY_MS / 1000;
-    chip->cmd_delay_ts.tv_nsec = (CHIP8E_CMD_TS_DELAY_MS % 1000) * 1000000;
+    chip8_timing_init(chip, CHIP8E_TIMING_NONE, 0);
 
     // Load sprites to memory
     chip8_block_to_mem(chip, CHIP8E_MEM_OFFSET_SPRITE_START, sprites, 5 * 16);
     // Start executing program memory
     chip->PC = CHIP8E_MEM_OFFSET_PROGRAM_START;
     chip->video_dirty = true;
-
+    chip->dirty_pages = 0xFFFF;
 }
 
 void chip8_load_program_block(chip8_p chip, uint8_t *buf, uint16_t size)
@@ -44,56 +58,99 @@ void chip8_load_program_block(chip8_p chip, uint8_t *buf, uint16_t size)
     chip8_block_to_mem(chip, CHIP8E_MEM_OFFSET_PROGRAM_START, buf, size);
 }
 
+// Number of bytes from offset that still fit in emulator memory
+static uint16_t chip8_mem_clamp(uint16_t offset, uint16_t size)
+{
+    uint16_t avail = CHIP8E_MEM_SIZE - CHIP8E_MEM_MASK(offset);
+    return (size > avail) ? avail : size;
+}
+
 void chip8_block_to_mem(chip8_p chip, uint16_t offset, uint8_t *buf, uint16_t size)
 {
-    memcpy(chip->memory + CHIP8E_MEM_MASK(offset), buf, CHIP8E_MEM_MASK(size));
+    uint16_t start = CHIP8E_MEM_MASK(offset);
+    uint16_t len = chip8_mem_clamp(offset, size);
+    memcpy(chip->memory + start, buf, len);
+    for (int p = start >> CHIP8E_PAGE_SHIFT; p < (start + len + CHIP8E_PAGE_SIZE - 1) >> CHIP8E_PAGE_SHIFT; p++)
+        chip->dirty_pages |= 1 << p;
+    if (chip->fusion)
+        chip8_fusion_scan(chip->fusion, chip->memory);
 }
 
 void chip8_mem_to_block(chip8_p chip, uint16_t offset, uint8_t *buf, uint16_t size)
 {
-    memcpy(buf, chip->memory + CHIP8E_MEM_MASK(offset), CHIP8E_MEM_MASK(size));
+    memcpy(buf, chip->memory + CHIP8E_MEM_MASK(offset), chip8_mem_clamp(offset, size));
 }
 
 int chip8_file_to_block(chip8_p chip, char *filename, uint8_t *buf, uint16_t *size)
 {
     struct stat sb;
 
+    CHIP8E_PROBE(rom_load_start, chip->PC, chip->opcode, chip->cycles, filename);
     int fd = open(filename, O_RDONLY);
     if (fd < 0) {
         printf("%s\n", strerror(errno));
+        CHIP8E_PROBE(rom_load_done, chip->PC, chip->opcode, chip->cycles, filename, -1);
 
         return EXIT_FAILURE;
     }
 
     if (fstat(fd, &sb) < 0) {
         printf("%s\n", strerror(errno));
+        close(fd);
+        CHIP8E_PROBE(rom_load_done, chip->PC, chip->opcode, chip->cycles, filename, -1);
 
         return EXIT_FAILURE;
     }
 
-    // Limit readable size by available emulator memory
-    *size = CHIP8E_MEM_MASK(sb.st_size);
+    // Limit readable size by available program memory
+    *size = chip8_mem_clamp(CHIP8E_MEM_OFFSET_PROGRAM_START,
+        (sb.st_size > CHIP8E_MEM_SIZE) ? CHIP8E_MEM_SIZE : sb.st_size);
     printf("Reading %d bytes from %s\n", *size, filename);
 
     if (read(fd, buf, *size) < 0) {
         printf("%s\n", strerror(errno));
         close(fd);
+        CHIP8E_PROBE(rom_load_done, chip->PC, chip->opcode, chip->cycles, filename, -1);
 
         return EXIT_FAILURE;
     }
 
     close(fd);
+    CHIP8E_PROBE(rom_load_done, chip->PC, chip->opcode, chip->cycles, filename,
+        (int)*size);
     return EXIT_SUCCESS;
 }
 
+uint64_t chip8_hash(const void *data, size_t size)
+{
+    const uint8_t *p = data;
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ size;
+    for (size_t i = 0; i + 8 <= size; i += 8) {
+        uint64_t w;
+        memcpy(&w, p + i, sizeof(w));
+        h = (h ^ w) * 0xBF58476D1CE4E5B9ULL;
+        h ^= h >> 31;
+    }
+    for (size_t i = size & ~(size_t)7; i < size; i++)
+        h = (h ^ p[i]) * 0x94D049BB133111EBULL;
+    return h ^ (h >> 29);
+}
+
 void chip8_trap(chip8_p chip)
 {
     //chip->state = CHIP_STATE_EXCEPTION;
-    // Print registers:
+    chip8_print_registers(chip);
+    // Print stack:
+    chip8_stack_print(chip);
+    chip8_memdump(chip, chip->PC);
+}
+
+void chip8_print_registers(chip8_p chip)
+{
     printf("--------------------------------\n");
     printf("CPU State:\n");
     printf("I:%04X[%02X] PC:%04X FLAG:%02X SP:%02X\n",
-        chip->I, chip->memory[chip->I], chip->PC, chip->V[VF], chip->SP);
+        chip->I, chip->memory[CHIP8E_MEM_MASK(chip->I)], chip->PC, chip->V[VF], chip->SP);
     printf("--------------------------------\n");
 
     for (int i = 0; i < 4; i++)
@@ -103,9 +160,6 @@ void chip8_trap(chip8_p chip)
             4 * i + 2, chip->V[4 * i + 2],
             4 * i + 3, chip->V[4 * i + 3]);
     printf("--------------------------------\n");
-    // Print stack:
-    chip8_stack_print(chip);
-    chip8_memdump(chip, chip->PC);
 }
 
 void chip8_memdump(chip8_p chip, uint16_t addr)
@@ -117,35 +171,46 @@ void chip8_memdump(chip8_p chip, uint16_t addr)
     for (int i = 0; i < (CHIP8E_MEMDUMP_BLOCK_SIZE >> 3); i++)
     printf("+%02X: %02x %02x %02x %02x %02x %02x %02x %02x\n",
             8 * i,
-            chip->memory[addr + 8 * i ],
-            chip->memory[addr + 8 * i + 1],
-            chip->memory[addr + 8 * i + 2],
-            chip->memory[addr + 8 * i + 3],
-            chip->memory[addr + 8 * i + 4],
-            chip->memory[addr + 8 * i + 5],
-            chip->memory[addr + 8 * i + 6],
-            chip->memory[addr + 8 * i + 7]
+            chip->memory[CHIP8E_MEM_MASK(addr + 8 * i)],
+            chip->memory[CHIP8E_MEM_MASK(addr + 8 * i + 1)],
+            chip->memory[CHIP8E_MEM_MASK(addr + 8 * i + 2)],
+            chip->memory[CHIP8E_MEM_MASK(addr + 8 * i + 3)],
+            chip->memory[CHIP8E_MEM_MASK(addr + 8 * i + 4)],
+            chip->memory[CHIP8E_MEM_MASK(addr + 8 * i + 5)],
+            chip->memory[CHIP8E_MEM_MASK(addr + 8 * i + 6)],
+            chip->memory[CHIP8E_MEM_MASK(addr + 8 * i + 7)]
             );
 }
 
-#define CHIP8_INSTR_CMD(cmd) (((cmd) & 0xF000) >> 12)
-#define CHIP8_INSTR_R1(cmd) (((cmd) & 0x0F00) >> 8)
-#define CHIP8_INSTR_R2(cmd) (((cmd) & 0x00F0) >> 4)
-#define CHIP8_INSTR_NIBBLE(cmd) (((cmd) & 0x00F))
-#define CHIP8_INSTR_BYTE(cmd) (((cmd) & 0x00FF))
-#define CHIP8_INSTR_ADDR(cmd) (((cmd) & 0x0FFF))
-
 // fetch instruction
 // decode
 // execute
 void chip8_cycle(chip8_p chip)
 {
-    uint16_t cmd = chip->memory[chip->PC] << 8 | chip->memory[chip->PC + 1];
+    // Skips and returns may step PC past the end of memory, wrap around
+    chip->PC = CHIP8E_MEM_MASK(chip->PC);
+    if (chip->watchdog && chip->instructions >= chip->watchdog->next
+        && chip8_watchdog_check(chip))
+        return;
+    if (chip->debug && chip8_debug_fetch(chip))
+        return;
+    if (chip->fusion && !chip->debug && chip->fusion->kind[chip->PC]) {
+        chip8_interpret_fused(chip, chip->fusion->kind[chip->PC]);
+        return;
+    }
+    uint16_t cmd = chip->memory[chip->PC] << 8 | chip->memory[CHIP8E_MEM_MASK(chip->PC + 1)];
+    chip->opcode = cmd;
+    if (chip->timing)
+        chip8_timing_account(chip, cmd);
     chip8_interpret_cmd(chip, cmd);
+    chip->instructions++;
+    if (chip->debug)
+        chip8_debug_retire(chip);
 }
 
 void chip8_interpret_cmd(chip8_p chip, uint16_t cmd)
 {
+    CHIP8E_PROBE(dispatch, chip->PC, cmd, chip->cycles);
     switch (CHIP8_INSTR_CMD(cmd)) {
         case 0x0:
             if (0x00E0 == cmd) {
@@ -284,3 +349,76 @@ void chip8_interpret_cmd(chip8_p chip, uint16_t cmd)
     }
 }
 
+// Each case runs its sequence through the plain instruction handlers, so
+// a fused sequence has exactly the effect of its instructions in order.
+// A taken skip leaves PC past the JP that ends a sequence.
+#define ACCOUNT(cmd) if (chip->timing) chip8_timing_account(chip, cmd)
+
+void chip8_interpret_fused(chip8_p chip, uint8_t kind)
+{
+    uint16_t pc = chip->PC;
+    uint16_t c0 = chip->memory[pc] << 8 | chip->memory[pc + 1];
+    uint16_t c1 = chip->memory[pc + 2] << 8 | chip->memory[pc + 3];
+    uint16_t c2 = chip->memory[pc + 4] << 8 | chip->memory[pc + 5];
+
+    switch (kind) {
+        case CHIP8E_FUSE_LDI_DRW:
+            ACCOUNT(c0);
+            i_ldiw(chip, CHIP8_INSTR_ADDR(c0));
+            ACCOUNT(c1);
+            i_drwvxvyn(chip, CHIP8_INSTR_R1(c1), CHIP8_INSTR_R2(c1), CHIP8_INSTR_NIBBLE(c1));
+            chip->opcode = c1;
+            chip->instructions += 2;
+        break;
+        case CHIP8E_FUSE_SE_JP:
+        case CHIP8E_FUSE_SNE_JP:
+            ACCOUNT(c0);
+            if (kind == CHIP8E_FUSE_SE_JP)
+                i_sevxb(chip, CHIP8_INSTR_R1(c0), CHIP8_INSTR_BYTE(c0));
+            else
+                i_snevxb(chip, CHIP8_INSTR_R1(c0), CHIP8_INSTR_BYTE(c0));
+            chip->opcode = c0;
+            chip->instructions++;
+            if (chip->PC == pc + 2) {
+                ACCOUNT(c1);
+                i_jp(chip, CHIP8_INSTR_ADDR(c1));
+                chip->opcode = c1;
+                chip->instructions++;
+            }
+        break;
+        case CHIP8E_FUSE_ADD_SE:
+        case CHIP8E_FUSE_LDDT_SE:
+            ACCOUNT(c0);
+            if (kind == CHIP8E_FUSE_ADD_SE)
+                i_addvxb(chip, CHIP8_INSTR_R1(c0), CHIP8_INSTR_BYTE(c0));
+            else
+                i_ldvxdt(chip, CHIP8_INSTR_R1(c0));
+            ACCOUNT(c1);
+            i_sevxb(chip, CHIP8_INSTR_R1(c1), CHIP8_INSTR_BYTE(c1));
+            chip->opcode = c1;
+            chip->instructions += 2;
+        break;
+        case CHIP8E_FUSE_ADD_SE_JP:
+        case CHIP8E_FUSE_LDDT_SE_JP:
+            ACCOUNT(c0);
+            if (kind == CHIP8E_FUSE_ADD_SE_JP)
+                i_addvxb(chip, CHIP8_INSTR_R1(c0), CHIP8_INSTR_BYTE(c0));
+            else
+                i_ldvxdt(chip, CHIP8_INSTR_R1(c0));
+            ACCOUNT(c1);
+            i_sevxb(chip, CHIP8_INSTR_R1(c1), CHIP8_INSTR_BYTE(c1));
+            chip->opcode = c1;
+            chip->instructions += 2;
+            if (chip->PC == pc + 4) {
+                ACCOUNT(c2);
+                i_jp(chip, CHIP8_INSTR_ADDR(c2));
+                chip->opcode = c2;
+                chip->instructions++;
+            }
+        break;
+        default:
+            chip->state = CHIP_STATE_EXCEPTION;
+            // not possible, fusion tags only the kinds above
+        break;
+    }
+}
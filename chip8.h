@@ -7,12 +7,21 @@
 #include <stdbool.h>
 #include <time.h>
 
-// Instruction time
-#define CHIP8E_CMD_TS_DELAY_MS 100
+// Instruction trace, build with -DCHIP8E_NO_TRACE to compile it out
+#ifdef CHIP8E_NO_TRACE
+#define CHIP8E_TRACE(...) do {} while (0)
+#else
+#define CHIP8E_TRACE(...) printf(__VA_ARGS__)
+#endif
 
 // bytes
 #define CHIP8E_MEM_SIZE 4096
 
+// Memory is tracked in pages of 256 bytes for copy on write, see pages.h
+#define CHIP8E_PAGE_SHIFT 8
+#define CHIP8E_PAGE_SIZE (1 << CHIP8E_PAGE_SHIFT)
+#define CHIP8E_PAGE_COUNT (CHIP8E_MEM_SIZE / CHIP8E_PAGE_SIZE)
+
 // Masks for valid memory and register arguments
 #define CHIP8E_MEM_MASK(n) ((n) & 0xFFF)
 #define CHIP8E_REG_MASK(n) ((n) & 0xF)
@@ -31,6 +40,18 @@
 #define CHIP8E_XRES 64
 #define CHIP8E_YRES 32
 
+// Hex keypad, one bit per key in chip8_t.keys
+#define CHIP8E_KEY_COUNT 16
+#define CHIP8E_KEY_BIT(k) (1u << CHIP8E_REG_MASK(k))
+
+// Instruction fields
+#define CHIP8_INSTR_CMD(cmd) (((cmd) & 0xF000) >> 12)
+#define CHIP8_INSTR_R1(cmd) (((cmd) & 0x0F00) >> 8)
+#define CHIP8_INSTR_R2(cmd) (((cmd) & 0x00F0) >> 4)
+#define CHIP8_INSTR_NIBBLE(cmd) (((cmd) & 0x00F))
+#define CHIP8_INSTR_BYTE(cmd) (((cmd) & 0x00FF))
+#define CHIP8_INSTR_ADDR(cmd) (((cmd) & 0x0FFF))
+
 // Used to clear memory
 #define CHIP8_EMPTY_WORD 0xFFFF
 #define CHIP8_EMPTY_BYTE 0xFF
@@ -63,7 +84,17 @@
 #define VF 0xF
 
 // used for traps
-typedef enum {CHIP_STATE_NORMAL, CHIP_STATE_EXCEPTION, CHIP_STATE_EXIT} chip8_state_t;
+typedef enum {CHIP_STATE_NORMAL, CHIP_STATE_EXCEPTION, CHIP_STATE_EXIT, CHIP_STATE_BREAK} chip8_state_t;
+
+// Instruction cost models, see timing.h
+typedef enum {CHIP8E_TIMING_NONE, CHIP8E_TIMING_FIXED, CHIP8E_TIMING_VIP} chip8_timing_t;
+
+// Debugger state, see debug.h
+struct chip8_debug;
+// Superinstruction tags, see fuse.h
+struct chip8_fusion;
+// Hang detection, see watchdog.h
+struct chip8_watchdog;
 
 // Processor, Memory and Video Status
 typedef struct {
@@ -74,6 +105,8 @@ typedef struct {
     // Modern GUI libraries usually do not deal well with 1-bpp depth.
     uint8_t video_buffer[CHIP8E_XRES * CHIP8E_YRES];
     bool video_dirty;
+    // Bit n set once memory page n is written, cleared by its user
+    uint16_t dirty_pages;
     uint16_t stack[CHIP8E_STACK_SIZE];
     // v0..15 general purpose register
     uint8_t V[16];
@@ -85,9 +118,26 @@ typedef struct {
     uint8_t SP;
     // Delay Timer, Sound Timer
     uint8_t DT, ST;
+    // Pressed keys, bit n set while key n is down
+    uint16_t keys;
+    // Per instance RNG state, so runs are reproducible from a seed
+    unsigned int seed;
     chip8_state_t state;
-    // Instruction delay timespec
-    struct timespec cmd_delay_ts;
+    // Attached debugger, NULL when not debugging
+    struct chip8_debug *debug;
+    // Fused sequences, NULL to run one instruction per cycle
+    struct chip8_fusion *fusion;
+    // Stops unattended runs that cannot progress, NULL when not watched
+    struct chip8_watchdog *watchdog;
+    // Retired instructions
+    uint64_t instructions;
+    // Emulated time: cycles charged so far, the cycle count of the next
+    // 60 Hz interrupt and the number of interrupts taken
+    chip8_timing_t timing;
+    uint32_t frame_cycles;
+    uint64_t cycles;
+    uint64_t next_frame;
+    uint64_t frames;
 } chip8_t, *chip8_p;
 
 // Initialize the emulator
@@ -98,17 +148,23 @@ void chip8_cycle(chip8_p chip);
 void chip8_load_program_block(chip8_p chip, uint8_t *buf, uint16_t size);
 // Display trapping info
 void chip8_trap(chip8_p chip);
+// Display CPU registers
+void chip8_print_registers(chip8_p chip);
 // Display memory dump
 void chip8_memdump(chip8_p chip, uint16_t addr);
 // Copy data block to emulator memory.
 void chip8_block_to_mem(chip8_p chip, uint16_t offset, uint8_t *buf, uint16_t size);
 // Copy emulator memory to data block.
 void chip8_mem_to_block(chip8_p chip, uint16_t offset, uint8_t *buf, uint16_t size);
+// 64 bit hash of a block, for telling machine states apart
+uint64_t chip8_hash(const void *data, size_t size);
 // Read file to passed block and set size to number of bytes read.
 int chip8_file_to_block(chip8_p chip, char *filename, uint8_t *buf, uint16_t *size);
 
 // A glorified switch case
 void chip8_interpret_cmd(chip8_p chip, uint16_t cmd);
+// Run the fused sequence of the given kind at PC
+void chip8_interpret_fused(chip8_p chip, uint8_t kind);
 
 #endif //__CHIP8_H
 
@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "chip8.h"
+#include "analyze.h"
+#include "aot.h"
+
+/**
+ * Ahead of time translator: writes a C file for the program that links
+ * with the core and chip8_aot_runner.c, see `make aot`.
+ **/
+
+void usage()
+{
+    printf("Usage: chip8e-aot -p progname -o output.c\n");
+    printf("Options:\n"
+    "\t-p file - specifies the binary to be translated.\n"
+    "\t-o file - C file to write, - for stdout.\n"
+    "\t-h      - this help.\n");
+}
+
+int main(int argc, char *argv[])
+{
+    static chip8_t chip;
+    static chip8_analysis_t an;
+    char *binary = NULL;
+    char *output = NULL;
+    int ch;
+
+    while ((ch = getopt(argc, argv, "p:o:h")) != -1) {
+        switch (ch) {
+            case 'p':
+                binary = optarg;
+            break;
+            case 'o':
+                output = optarg;
+            break;
+            case 'h':
+            case '?':
+            default:
+                usage();
+                exit(EXIT_SUCCESS);
+            break;
+        }
+    }
+    if (NULL == binary || NULL == output) {
+        usage();
+        exit(EXIT_SUCCESS);
+    }
+
+    chip8_init(&chip);
+    uint8_t file_buf[CHIP8E_MEM_SIZE];
+    uint16_t size = 0;
+    if (EXIT_SUCCESS != chip8_file_to_block(&chip, binary, file_buf, &size)) {
+        printf("Error loading file %s.\n", binary);
+        exit(EXIT_FAILURE);
+    }
+    chip8_load_program_block(&chip, file_buf, size);
+    chip8_analyze(&an, chip.memory, CHIP8E_MEM_OFFSET_PROGRAM_START + size);
+
+    FILE *out = strcmp(output, "-") ? fopen(output, "w") : stdout;
+    if (NULL == out) {
+        printf("%s: %s\n", output, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    chip8_aot_emit(&an, chip.memory, out);
+    if (out != stdout)
+        fclose(out);
+
+    printf("Translated %d basic blocks.\n", an.block_count);
+    return EXIT_SUCCESS;
+}
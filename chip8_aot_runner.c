@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "chip8.h"
+#include "aot.h"
+
+/**
+ * Headless runner for a program translated by chip8e-aot. The program
+ * image is part of the translation, no ROM file is read.
+ *
+ * Timers tick once per slice of instructions. In compare mode the
+ * interpreter runs alongside and the states are checked after each slice.
+ **/
+
+#define CHIP8E_AOT_SLICE 64
+#define CHIP8E_AOT_BUDGET 10000000
+#define CHIP8E_AOT_SEED 0x5eed
+
+void usage()
+{
+    printf("Usage: chip8e-aot-run [-n instructions] [-k keys] [-i | -c]\n");
+    printf("Options:\n"
+    "\t-n count - instructions to run, default %d.\n"
+    "\t-k keys  - keypad state as a hex bitmask.\n"
+    "\t-i       - runs on the interpreter instead.\n"
+    "\t-c       - runs both and compares their states.\n"
+    "\t-h       - this help.\n", CHIP8E_AOT_BUDGET);
+}
+
+static void setup(chip8_p chip, uint16_t keys)
+{
+    const chip8_aot_program_t *prog = &chip8_aot_program;
+    chip8_init(chip);
+    chip->seed = CHIP8E_AOT_SEED;
+    chip->keys = keys;
+    chip8_block_to_mem(chip, prog->start, (uint8_t *)prog->image, prog->end - prog->start);
+}
+
+static void tick(chip8_p chip)
+{
+    if (chip->DT > 0)
+        chip->DT--;
+    if (chip->ST > 0)
+        chip->ST--;
+}
+
+static bool same_state(chip8_p a, chip8_p b)
+{
+    return a->PC == b->PC && a->I == b->I && a->SP == b->SP && a->state == b->state &&
+        !memcmp(a->V, b->V, sizeof(a->V)) &&
+        !memcmp(a->stack, b->stack, sizeof(a->stack)) &&
+        !memcmp(a->memory, b->memory, sizeof(a->memory)) &&
+        !memcmp(a->video_buffer, b->video_buffer, sizeof(a->video_buffer));
+}
+
+int main(int argc, char *argv[])
+{
+    static chip8_t chip, ref;
+    static chip8_aot_t rt;
+    uint64_t budget = CHIP8E_AOT_BUDGET;
+    uint16_t keys = 0;
+    bool interpret = false;
+    bool compare = false;
+    int ch;
+
+    while ((ch = getopt(argc, argv, "n:k:ich")) != -1) {
+        switch (ch) {
+            case 'n':
+                budget = strtoull(optarg, NULL, 0);
+            break;
+            case 'k':
+                keys = strtoul(optarg, NULL, 16);
+            break;
+            case 'i':
+                interpret = true;
+            break;
+            case 'c':
+                compare = true;
+            break;
+            case 'h':
+            case '?':
+            default:
+                usage();
+                exit(EXIT_SUCCESS);
+            break;
+        }
+    }
+
+    setup(&chip, keys);
+    setup(&ref, keys);
+    if (EXIT_SUCCESS != chip8_aot_init(&rt, &chip8_aot_program, &chip))
+        exit(EXIT_FAILURE);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (chip.state == CHIP_STATE_NORMAL && chip.instructions < budget) {
+        if (interpret) {
+            uint64_t stop = chip.instructions + CHIP8E_AOT_SLICE;
+            while (chip.state == CHIP_STATE_NORMAL && chip.instructions < stop)
+                chip8_cycle(&chip);
+        } else {
+            chip8_aot_run(&rt, &chip, CHIP8E_AOT_SLICE);
+        }
+        tick(&chip);
+
+        if (compare) {
+            // Translated blocks may overshoot the slice, catch up
+            while (ref.state == CHIP_STATE_NORMAL && ref.instructions < chip.instructions)
+                chip8_cycle(&ref);
+            tick(&ref);
+            if (!same_state(&chip, &ref)) {
+                printf("States differ after %lu instructions.\n",
+                    (unsigned long)chip.instructions);
+                chip8_trap(&chip);
+                chip8_trap(&ref);
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("%s: %lu instructions in %.3f s, %.1f M instructions/s, PC %04X\n",
+        interpret ? "interpreter" : "translated", (unsigned long)chip.instructions,
+        secs, chip.instructions / secs / 1e6, chip.PC);
+    if (chip.state == CHIP_STATE_EXCEPTION)
+        chip8_trap(&chip);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "chip8.h"
+#include "analyze.h"
+
+/**
+ * Static ROM analyzer: prints an annotated disassembly of the program
+ * and optionally writes its control flow graph in DOT format.
+ **/
+
+void usage()
+{
+    printf("Usage: chip8e-cfg -p progname [-g graph.dot]\n");
+    printf("Options:\n"
+    "\t-p file - specifies the binary to be analyzed.\n"
+    "\t-g file - writes the control flow graph to file, - for stdout;\n"
+    "\t          everything else then goes to stderr.\n"
+    "\t-q      - no disassembly listing.\n"
+    "\t-h      - this help.\n");
+}
+
+int main(int argc, char *argv[])
+{
+    static chip8_t chip;
+    static chip8_analysis_t an;
+    char *binary = NULL;
+    char *graph = NULL;
+    bool listing = true;
+    int ch;
+
+    while ((ch = getopt(argc, argv, "p:g:qh")) != -1) {
+        switch (ch) {
+            case 'p':
+                binary = optarg;
+            break;
+            case 'g':
+                graph = optarg;
+            break;
+            case 'q':
+                listing = false;
+            break;
+            case 'h':
+            case '?':
+            default:
+                usage();
+                exit(EXIT_SUCCESS);
+            break;
+        }
+    }
+    if (NULL == binary) {
+        usage();
+        exit(EXIT_SUCCESS);
+    }
+
+    // A graph on stdout is piped to dot: keep the original stdout for it
+    // and send the loader message, summary and listing to stderr
+    FILE *out = NULL;
+    if (NULL != graph && !strcmp(graph, "-")) {
+        int fd = dup(STDOUT_FILENO);
+        if (fd < 0 || NULL == (out = fdopen(fd, "w"))
+            || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+            printf("stdout: %s\n", strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    chip8_init(&chip);
+    uint8_t file_buf[CHIP8E_MEM_SIZE];
+    uint16_t size = 0;
+    if (EXIT_SUCCESS != chip8_file_to_block(&chip, binary, file_buf, &size)) {
+        printf("Error loading file %s.\n", binary);
+        exit(EXIT_FAILURE);
+    }
+    chip8_load_program_block(&chip, file_buf, size);
+
+    chip8_analyze(&an, chip.memory, CHIP8E_MEM_OFFSET_PROGRAM_START + size);
+
+    int code = 0;
+    for (int i = CHIP8E_MEM_OFFSET_PROGRAM_START; i < CHIP8E_MEM_OFFSET_PROGRAM_START + size; i++)
+        if (an.flags[i] & (CHIP8E_AN_CODE | CHIP8E_AN_OPERAND))
+            code++;
+    printf("%d basic blocks, %d code bytes, %d data bytes.\n",
+        an.block_count, code, size > code ? size - code : 0);
+
+    if (listing)
+        chip8_analysis_listing(&an, chip.memory, stdout);
+
+    if (NULL != graph) {
+        if (NULL == out && NULL == (out = fopen(graph, "w"))) {
+            printf("%s: %s\n", graph, strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        chip8_analysis_dot(&an, chip.memory, out);
+        fclose(out);
+    }
+
+    return EXIT_SUCCESS;
+}
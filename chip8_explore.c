@@ -0,0 +1,142 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "chip8.h"
+#include "analyze.h"
+#include "explore.h"
+
+/**
+ * Breadth first exploration of the states a ROM can reach one frame and
+ * one input at a time, see explore.h. Reports what was reached: PCs,
+ * distinct frames, states, and how much a stored state costs.
+ **/
+
+#define CHIP8E_EXPLORE_DEFAULT_STATES 1000000
+#define CHIP8E_EXPLORE_DEFAULT_DEPTH 600
+
+void usage()
+{
+    printf("Usage: chip8e-explore -p progname [-j threads] [-n states] [-d depth]\n");
+    printf("Options:\n"
+    "\t-p file    - specifies the binary to be explored.\n"
+    "\t-j threads - worker threads, default one per CPU.\n"
+    "\t-n states  - stops after this many distinct states, default %d.\n"
+    "\t-d depth   - stops after this many frames, default %d.\n"
+    "\t-q         - no per level report.\n"
+    "\t-h         - this help.\n",
+    CHIP8E_EXPLORE_DEFAULT_STATES, CHIP8E_EXPLORE_DEFAULT_DEPTH);
+}
+
+static double elapsed(struct timespec *since)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - since->tv_sec) + (now.tv_nsec - since->tv_nsec) / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+    static chip8_t chip;
+    static chip8_analysis_t an;
+    static chip8_explore_t ex;
+    char *binary = NULL;
+    int threads = sysconf(_SC_NPROCESSORS_ONLN);
+    long max_states = CHIP8E_EXPLORE_DEFAULT_STATES;
+    int max_depth = CHIP8E_EXPLORE_DEFAULT_DEPTH;
+    bool verbose = true;
+    int ch;
+
+    while ((ch = getopt(argc, argv, "p:j:n:d:qh")) != -1) {
+        switch (ch) {
+            case 'p':
+                binary = optarg;
+            break;
+            case 'j':
+                threads = atoi(optarg);
+            break;
+            case 'n':
+                max_states = atol(optarg);
+            break;
+            case 'd':
+                max_depth = atoi(optarg);
+            break;
+            case 'q':
+                verbose = false;
+            break;
+            case 'h':
+            case '?':
+            default:
+                usage();
+                exit(EXIT_SUCCESS);
+            break;
+        }
+    }
+    if (NULL == binary || max_states < 1 || max_depth < 1 || max_depth > UINT16_MAX) {
+        usage();
+        exit(EXIT_SUCCESS);
+    }
+
+    chip8_init(&chip);
+    uint8_t file_buf[CHIP8E_MEM_SIZE];
+    uint16_t size = 0;
+    if (EXIT_SUCCESS != chip8_file_to_block(&chip, binary, file_buf, &size)) {
+        printf("Error loading file %s.\n", binary);
+        exit(EXIT_FAILURE);
+    }
+    chip8_load_program_block(&chip, file_buf, size);
+    // Fixed, so runs are repeatable
+    chip.seed = 1;
+    chip8_analyze(&an, chip.memory, CHIP8E_MEM_OFFSET_PROGRAM_START + size);
+
+    if (EXIT_SUCCESS != chip8_explore_init(&ex, &chip, threads, max_states, max_depth)) {
+        printf("Out of memory.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (verbose)
+        printf("%6s %9s %9s %10s %9s\n", "DEPTH", "FRONTIER", "NEW", "STATES", "FRAMES");
+    for (;;) {
+        uint32_t frontier = ex.frontier_count;
+        uint32_t found = chip8_explore_level(&ex);
+        if (verbose && frontier)
+            printf("%6u %9u %9u %10u %9llu\n", ex.depth, frontier, found, ex.state_count,
+                (unsigned long long)ex.frames.count);
+        if (0 == found)
+            break;
+    }
+    double seconds = elapsed(&start);
+
+    int covered = 0, code = 0, code_covered = 0;
+    for (int pc = 0; pc < CHIP8E_MEM_SIZE; pc++) {
+        bool hit = ex.coverage[pc >> 3] & (1 << (pc & 0x7));
+        covered += hit;
+        if (an.flags[pc] & CHIP8E_AN_CODE) {
+            code++;
+            code_covered += hit;
+        }
+    }
+    const char *stop = (ex.state_count >= ex.max_states) ? "state limit"
+        : (ex.depth >= ex.max_depth && ex.frontier_count) ? "depth limit" : "exhausted";
+
+    printf("Stopped at depth %u: %s.\n", ex.depth, stop);
+    printf("%u states, %llu distinct frames, %llu forks, %llu exceptions.\n",
+        ex.state_count, (unsigned long long)ex.frames.count,
+        (unsigned long long)ex.forks, (unsigned long long)ex.exceptions);
+    printf("%d PCs executed, %d of %d instructions found by the analyzer.\n",
+        covered, code_covered, code);
+    printf("%llu bytes stored, %llu per state, %zu per image.\n",
+        (unsigned long long)ex.stored_bytes,
+        (unsigned long long)(ex.stored_bytes / ex.state_count), sizeof(chip8_image_t));
+    printf("%.2f s, %.0f forks/s on %d threads.\n",
+        seconds, seconds > 0 ? ex.forks / seconds : 0.0, ex.threads);
+
+    chip8_explore_free(&ex);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,179 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "chip8.h"
+#include "timing.h"
+#include "pages.h"
+
+/**
+ * Runs a fleet of instances forked from one loaded ROM, each with its
+ * own key input, and reports the resident memory they take: in copy on
+ * write pages (see pages.h) or, with -F, as plain chip8_t.
+ **/
+
+#define CHIP8E_FLEET_DEFAULT_INSTANCES 100000
+#define CHIP8E_FLEET_DEFAULT_FRAMES 600
+#define CHIP8E_FLEET_DEFAULT_SLICE 60
+
+void usage()
+{
+    printf("Usage: chip8e-fleet -p progname [-n instances] [-f frames] [-s frames] [-F]\n");
+    printf("Options:\n"
+    "\t-p file      - specifies the binary to be run.\n"
+    "\t-n instances - fleet size, default %d.\n"
+    "\t-f frames    - frames each instance runs, default %d.\n"
+    "\t-s frames    - frames an instance runs before the next one, default %d.\n"
+    "\t-F           - plain chip8_t instances instead of shared pages.\n"
+    "\t-h           - this help.\n",
+    CHIP8E_FLEET_DEFAULT_INSTANCES, CHIP8E_FLEET_DEFAULT_FRAMES, CHIP8E_FLEET_DEFAULT_SLICE);
+}
+
+static uint64_t resident(void)
+{
+    unsigned long size = 0, pages = 0;
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (NULL == f)
+        return 0;
+    if (2 != fscanf(f, "%lu %lu", &size, &pages))
+        pages = 0;
+    fclose(f);
+    return (uint64_t)pages * sysconf(_SC_PAGESIZE);
+}
+
+// A different key, or none, for every instance and slice
+static uint16_t fleet_keys(uint32_t instance, uint32_t slice)
+{
+    uint32_t k = (instance * 7 + slice) % (CHIP8E_KEY_COUNT + 1);
+    return k ? CHIP8E_KEY_BIT(k - 1) : 0;
+}
+
+static void run_frames(chip8_p chip, uint64_t frames)
+{
+    uint64_t end = chip->frames + frames;
+    while (chip->state == CHIP_STATE_NORMAL && chip->frames < end)
+        chip8_cycle(chip);
+}
+
+int main(int argc, char *argv[])
+{
+    static chip8_t chip;
+    char *binary = NULL;
+    long instances = CHIP8E_FLEET_DEFAULT_INSTANCES;
+    long frames = CHIP8E_FLEET_DEFAULT_FRAMES;
+    long slice = CHIP8E_FLEET_DEFAULT_SLICE;
+    bool flat = false;
+    int ch;
+
+    while ((ch = getopt(argc, argv, "p:n:f:s:Fh")) != -1) {
+        switch (ch) {
+            case 'p':
+                binary = optarg;
+            break;
+            case 'n':
+                instances = atol(optarg);
+            break;
+            case 'f':
+                frames = atol(optarg);
+            break;
+            case 's':
+                slice = atol(optarg);
+            break;
+            case 'F':
+                flat = true;
+            break;
+            case 'h':
+            case '?':
+            default:
+                usage();
+                exit(EXIT_SUCCESS);
+            break;
+        }
+    }
+    if (NULL == binary || instances < 1 || frames < 1 || slice < 1) {
+        usage();
+        exit(EXIT_SUCCESS);
+    }
+
+    chip8_init(&chip);
+    uint8_t file_buf[CHIP8E_MEM_SIZE];
+    uint16_t size = 0;
+    if (EXIT_SUCCESS != chip8_file_to_block(&chip, binary, file_buf, &size)) {
+        printf("Error loading file %s.\n", binary);
+        exit(EXIT_FAILURE);
+    }
+    chip8_load_program_block(&chip, file_buf, size);
+    chip8_timing_init(&chip, CHIP8E_TIMING_VIP, 0);
+    chip.seed = 1;
+
+    uint64_t before = resident();
+    chip8_paged_t snapshot;
+    chip8_paged_p fleet = NULL;
+    chip8_p machines = NULL;
+    if (flat) {
+        machines = malloc(instances * sizeof(chip8_t));
+        if (NULL == machines) {
+            printf("Out of memory.\n");
+            exit(EXIT_FAILURE);
+        }
+        for (long i = 0; i < instances; i++)
+            machines[i] = chip;
+    } else {
+        fleet = malloc(instances * sizeof(chip8_paged_t));
+        if (NULL == fleet || EXIT_SUCCESS != chip8_paged_save(&snapshot, &chip)) {
+            printf("Out of memory.\n");
+            exit(EXIT_FAILURE);
+        }
+        for (long i = 0; i < instances; i++)
+            chip8_paged_fork(&fleet[i], &snapshot);
+    }
+    uint64_t forked = resident();
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uint64_t instructions = 0;
+    for (long done = 0, s = 0; done < frames; done += slice, s++) {
+        long n = (frames - done < slice) ? frames - done : slice;
+        for (long i = 0; i < instances; i++) {
+            chip8_p m = flat ? &machines[i] : &chip;
+            if (!flat)
+                chip8_paged_load(&fleet[i], m);
+            uint64_t first = m->instructions;
+            m->keys = fleet_keys(i, s);
+            run_frames(m, n);
+            instructions += m->instructions - first;
+            if (!flat && EXIT_SUCCESS != chip8_paged_store(&fleet[i], m)) {
+                printf("Out of memory.\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    uint64_t after = resident();
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    printf("%ld instances of %s, %ld frames each, %s.\n", instances, binary, frames,
+        flat ? "plain" : "paged");
+    printf("%llu instructions in %.2f s, %.1f M/s.\n", (unsigned long long)instructions,
+        seconds, seconds > 0 ? instructions / seconds / 1e6 : 0.0);
+    printf("Resident per instance: %.0f bytes forked, %.0f bytes after the run.\n",
+        (double)(forked - before) / instances, (double)(after - before) / instances);
+    if (!flat) {
+        uint64_t live = chip8_paged_live();
+        printf("%llu pages live, %.2f per instance; %zu bytes of registers and tables, "
+            "%zu per page.\n", (unsigned long long)live, (double)live / instances,
+            sizeof(chip8_paged_t), sizeof(chip8_page_t));
+        for (long i = 0; i < instances; i++)
+            chip8_paged_free(&fleet[i]);
+        chip8_paged_free(&snapshot);
+    } else {
+        printf("%zu bytes per chip8_t.\n", sizeof(chip8_t));
+    }
+    free(fleet);
+    free(machines);
+    return EXIT_SUCCESS;
+}
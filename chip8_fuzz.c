@@ -0,0 +1,218 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "chip8.h"
+#include "fuse.h"
+#include "timing.h"
+
+/**
+ * libFuzzer target for the CHIP8 core.
+ *
+ * Input layout:
+ *   byte 0    - flags, bit 0 selects differential mode,
+ *               the remaining bits pick the engine compared against
+ *   byte 1..2 - keypad state, MSB first
+ *   byte 3..  - program image loaded at 0x200
+ *
+ * In differential mode two machines start from the same image and seed
+ * and are stepped in lockstep by different engines. An engine may retire
+ * several instructions per step, the reference catches up on the
+ * instruction count before the states are compared. The first step after
+ * which they differ aborts the run with both states dumped.
+ *
+ * Build with `make fuzz` (clang, libFuzzer, ASan, UBSan), or with
+ * `make fuzz-replay` for a driver that replays files without libFuzzer
+ * and reports execs/sec.
+ **/
+
+// Instructions executed per input
+#define CHIP8E_FUZZ_STEPS 1024
+// Keypad state rotates by one key every this many steps
+#define CHIP8E_FUZZ_KEY_PERIOD 128
+#define CHIP8E_FUZZ_HEADER 3
+#define CHIP8E_FUZZ_SEED 0x5eed
+
+#define CHIP8E_FUZZ_FLAG_DIFF 0x01
+
+typedef struct {
+    const char *name;
+    // Prepare a machine after the program is loaded, may be NULL
+    void (*setup)(chip8_p chip);
+    void (*step)(chip8_p chip);
+} chip8_engine_t;
+
+static chip8_fusion_t fusion;
+
+static void chip8_fuzz_fused(chip8_p chip)
+{
+    chip8_fusion_attach(chip, &fusion);
+}
+
+// Engine 0 is the reference, the others are checked against it.
+// Running the reference on a second instance catches state leaking
+// between instances or fields left uninitialized by chip8_init().
+static const chip8_engine_t engines[] = {
+    { "reference", NULL, chip8_cycle },
+    { "reference", NULL, chip8_cycle },
+    { "fused", chip8_fuzz_fused, chip8_cycle },
+};
+
+#define CHIP8E_FUZZ_ENGINES (sizeof(engines) / sizeof(engines[0]))
+
+static void chip8_fuzz_setup(chip8_p chip, const chip8_engine_t *engine,
+    uint16_t keys, const uint8_t *rom, size_t size)
+{
+    chip8_init(chip);
+    chip->seed = CHIP8E_FUZZ_SEED;
+    chip->keys = keys;
+    chip8_timing_init(chip, CHIP8E_TIMING_VIP, 0);
+    chip8_load_program_block(chip, (uint8_t *)rom,
+        (size > CHIP8E_MEM_SIZE) ? CHIP8E_MEM_SIZE : size);
+    if (engine->setup)
+        engine->setup(chip);
+}
+
+// Input, the part the frontend does between cycles. Timers run on the
+// core's VIP clock. Driven by the retired instruction count so engines
+// that retire several instructions per step see the same keypad.
+static void chip8_fuzz_tick(chip8_p chip, uint64_t *ticks)
+{
+    for (; *ticks < chip->instructions; (*ticks)++) {
+        if (0 == (*ticks + 1) % CHIP8E_FUZZ_KEY_PERIOD)
+            chip->keys = (chip->keys << 1) | (chip->keys >> 15);
+    }
+}
+
+// Name of the first field that differs, NULL when the states match
+static const char *chip8_fuzz_compare(chip8_p a, chip8_p b)
+{
+    if (a->state != b->state)
+        return "state";
+    if (a->PC != b->PC)
+        return "PC";
+    if (a->I != b->I)
+        return "I";
+    if (a->SP != b->SP)
+        return "SP";
+    if (a->DT != b->DT || a->ST != b->ST)
+        return "timers";
+    if (a->cycles != b->cycles || a->frames != b->frames)
+        return "cycles";
+    if (memcmp(a->V, b->V, sizeof(a->V)))
+        return "V";
+    if (memcmp(a->stack, b->stack, sizeof(a->stack)))
+        return "stack";
+    if (memcmp(a->memory, b->memory, sizeof(a->memory)))
+        return "memory";
+    if (memcmp(a->video_buffer, b->video_buffer, sizeof(a->video_buffer)))
+        return "video_buffer";
+    return NULL;
+}
+
+static void chip8_fuzz_single(uint16_t keys, const uint8_t *rom, size_t size)
+{
+    chip8_t chip;
+    uint64_t ticks = 0;
+    chip8_fuzz_setup(&chip, &engines[0], keys, rom, size);
+    for (int step = 0; step < CHIP8E_FUZZ_STEPS; step++) {
+        if (chip.state != CHIP_STATE_NORMAL)
+            break;
+        chip8_cycle(&chip);
+        chip8_fuzz_tick(&chip, &ticks);
+    }
+}
+
+static void chip8_fuzz_differential(const chip8_engine_t *other, uint16_t keys,
+    const uint8_t *rom, size_t size)
+{
+    chip8_t a, b;
+    uint64_t ticks_a = 0, ticks_b = 0;
+    chip8_fuzz_setup(&a, &engines[0], keys, rom, size);
+    chip8_fuzz_setup(&b, other, keys, rom, size);
+
+    for (int step = 0; step < CHIP8E_FUZZ_STEPS; step++) {
+        if (b.state != CHIP_STATE_NORMAL)
+            break;
+        uint16_t pc = b.PC;
+        other->step(&b);
+        chip8_fuzz_tick(&b, &ticks_b);
+        do {
+            engines[0].step(&a);
+            chip8_fuzz_tick(&a, &ticks_a);
+        } while (a.instructions < b.instructions && a.state == CHIP_STATE_NORMAL);
+
+        const char *field = chip8_fuzz_compare(&a, &b);
+        if (NULL != field) {
+            printf("Divergence in %s after step %d at %04X (%s vs %s)\n",
+                field, step, pc, engines[0].name, other->name);
+            chip8_trap(&a);
+            chip8_trap(&b);
+            fflush(stdout);
+            abort();
+        }
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    if (size < CHIP8E_FUZZ_HEADER)
+        return 0;
+
+    uint8_t flags = data[0];
+    uint16_t keys = data[1] << 8 | data[2];
+    const uint8_t *rom = data + CHIP8E_FUZZ_HEADER;
+    size -= CHIP8E_FUZZ_HEADER;
+
+    if (flags & CHIP8E_FUZZ_FLAG_DIFF) {
+        const chip8_engine_t *other =
+            &engines[1 + (flags >> 1) % (CHIP8E_FUZZ_ENGINES - 1)];
+        chip8_fuzz_differential(other, keys, rom, size);
+    } else {
+        chip8_fuzz_single(keys, rom, size);
+    }
+    return 0;
+}
+
+#ifdef CHIP8E_FUZZ_STANDALONE
+
+#include <time.h>
+
+// Replays each file this many times
+#define CHIP8E_FUZZ_REPLAYS 1000
+
+int main(int argc, char *argv[])
+{
+    static uint8_t buf[CHIP8E_FUZZ_HEADER + CHIP8E_MEM_SIZE];
+    struct timespec start, end;
+    long execs = 0;
+
+    if (argc < 2) {
+        printf("Usage: %s file...\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 1; i < argc; i++) {
+        FILE *f = fopen(argv[i], "rb");
+        if (NULL == f) {
+            printf("Cannot open %s.\n", argv[i]);
+            return EXIT_FAILURE;
+        }
+        size_t size = fread(buf, 1, sizeof(buf), f);
+        fclose(f);
+
+        for (int n = 0; n < CHIP8E_FUZZ_REPLAYS; n++)
+            LLVMFuzzerTestOneInput(buf, size);
+        execs += CHIP8E_FUZZ_REPLAYS;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("%ld execs in %.3f s, %.0f execs/sec\n", execs, secs, execs / secs);
+    return EXIT_SUCCESS;
+}
+
+#endif // CHIP8E_FUZZ_STANDALONE
@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <dirent.h>
+#include <sys/mman.h>
+
+#include "chip8.h"
+#include "stats.h"
+
+/**
+ * Lists every chip8e on the host that publishes statistics (-T), one
+ * line per instance and a total, refreshed every interval.
+ **/
+
+// Where POSIX shared memory objects show up on Linux
+#define CHIP8E_TOP_SHM_DIR "/dev/shm"
+#define CHIP8E_TOP_MAX 4096
+
+static const char *states[] = { "run", "EXC", "exit", "break" };
+
+void usage()
+{
+    printf("Usage: chip8e-top [-1] [-i seconds] [-c]\n");
+    printf("Options:\n"
+    "\t-1         - prints once and exits.\n"
+    "\t-i seconds - refresh interval, default 1.\n"
+    "\t-c         - removes segments of processes that are gone.\n"
+    "\t-h         - this help.\n");
+}
+
+static int instance_pids(int *pids, int max)
+{
+    // Without the leading slash of the segment name
+    const char *prefix = CHIP8E_STATS_PREFIX + 1;
+    int count = 0;
+    DIR *dir = opendir(CHIP8E_TOP_SHM_DIR);
+    if (NULL == dir)
+        return 0;
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL && count < max) {
+        if (strncmp(ent->d_name, prefix, strlen(prefix)))
+            continue;
+        int pid = atoi(ent->d_name + strlen(prefix));
+        if (pid > 0)
+            pids[count++] = pid;
+    }
+    closedir(dir);
+    return count;
+}
+
+static bool alive(int pid)
+{
+    return 0 == kill(pid, 0) || errno == EPERM;
+}
+
+static void show(bool clean)
+{
+    static int pids[CHIP8E_TOP_MAX];
+    int count = instance_pids(pids, CHIP8E_TOP_MAX);
+    uint64_t now = chip8_stats_now();
+    uint64_t total_ips = 0, total_frames = 0, total_dropped = 0;
+    int shown = 0, running = 0;
+
+    printf("%7s %-20s %5s %10s %9s %7s %8s %8s %8s %8s %6s\n",
+        "PID", "ROM", "STATE", "IPS", "FRAMES", "DROP",
+        "FRM50us", "FRM99us", "PRS99us", "OVRavgus", "PC");
+    for (int i = 0; i < count; i++) {
+        chip8_stats_t s;
+        const chip8_stats_t *shared = chip8_stats_attach(pids[i]);
+        if (NULL == shared)
+            continue;
+        int rc = chip8_stats_snapshot(shared, &s);
+        chip8_stats_detach(shared);
+        if (EXIT_SUCCESS != rc)
+            continue;
+
+        bool gone = !alive(s.pid);
+        if (gone && clean) {
+            char path[32];
+            snprintf(path, sizeof(path), CHIP8E_STATS_PREFIX "%d", s.pid);
+            shm_unlink(path);
+            continue;
+        }
+        // An exception outlives the process, anything else just ended
+        const char *state = (s.state < sizeof(states) / sizeof(states[0])) ? states[s.state] : "?";
+        if (gone && s.state != CHIP_STATE_EXCEPTION)
+            state = "gone";
+        // A process that stopped updating is not running at its last rate
+        uint64_t ips = (gone || now - s.updated > 2000000000ULL) ? 0 : s.ips;
+
+        printf("%7d %-20.20s %5s %10llu %9llu %7llu %8llu %8llu %8llu %8llu   %04X\n",
+            s.pid, s.rom, state,
+            (unsigned long long)ips,
+            (unsigned long long)s.frames,
+            (unsigned long long)s.dropped,
+            (unsigned long long)chip8_stats_percentile(s.frame_hist, 0.5),
+            (unsigned long long)chip8_stats_percentile(s.frame_hist, 0.99),
+            (unsigned long long)chip8_stats_percentile(s.present_hist, 0.99),
+            (unsigned long long)(s.paced ? s.overshoot_total / s.paced / 1000 : 0),
+            s.PC);
+        shown++;
+        total_ips += ips;
+        total_frames += s.frames;
+        total_dropped += s.dropped;
+        running += (ips > 0);
+    }
+    printf("%d instances, %d running, %llu IPS, %llu frames, %llu dropped\n",
+        shown, running, (unsigned long long)total_ips,
+        (unsigned long long)total_frames, (unsigned long long)total_dropped);
+}
+
+int main(int argc, char *argv[])
+{
+    bool once = false, clean = false;
+    int interval = 1;
+    int ch;
+
+    while ((ch = getopt(argc, argv, "1i:ch")) != -1) {
+        switch (ch) {
+            case '1':
+                once = true;
+            break;
+            case 'i':
+                interval = atoi(optarg);
+                if (interval < 1)
+                    interval = 1;
+            break;
+            case 'c':
+                clean = true;
+            break;
+            case 'h':
+            case '?':
+            default:
+                usage();
+                exit(EXIT_SUCCESS);
+            break;
+        }
+    }
+
+    for (;;) {
+        if (!once)
+            printf("\x1b[H\x1b[2J");
+        show(clean);
+        fflush(stdout);
+        if (once)
+            break;
+        sleep(interval);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "chip8.h"
+#include "stream.h"
+#include "display.h"
+
+/**
+ * Reference viewer for the frame stream, see stream.h. Draws the frames
+ * with the terminal display and sends the keypad back.
+ **/
+
+void usage()
+{
+    printf("Usage: chip8e-view -s socket\n");
+    printf("Options:\n"
+    "\t-s path - socket of a chip8e started with -S path.\n"
+    "\t-h      - this help.\n"
+    "Keys 1234/qwer/asdf/zxcv are the keypad, Esc or Ctrl-C quits.\n");
+}
+
+// Unpack a stream frame into a one byte per pixel video buffer
+static void unpack(chip8_stream_frame_t frame, uint8_t *video_buffer)
+{
+    for (int y = 0; y < CHIP8E_YRES; y++)
+        for (int x = 0; x < CHIP8E_XRES; x++)
+            video_buffer[y * CHIP8E_XRES + x] = (frame[y][x >> 3] >> (7 - (x & 0x7))) & 0x1;
+}
+
+int main(int argc, char *argv[])
+{
+    struct sockaddr_un addr;
+    chip8_stream_frame_t frame;
+    uint8_t video_buffer[CHIP8E_XRES * CHIP8E_YRES];
+    const chip8_display_t *display = &chip8_display_term;
+    uint16_t keys = 0;
+    int result = EXIT_SUCCESS;
+    char *path = NULL;
+    int ch;
+
+    while ((ch = getopt(argc, argv, "s:h")) != -1) {
+        switch (ch) {
+            case 's':
+                path = optarg;
+            break;
+            case 'h':
+            case '?':
+            default:
+                usage();
+                exit(EXIT_SUCCESS);
+            break;
+        }
+    }
+    if (NULL == path || strlen(path) >= sizeof(addr.sun_path)) {
+        usage();
+        exit(EXIT_SUCCESS);
+    }
+
+    memset(&addr, 0x00, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        printf("Cannot connect to %s: %s\n", path, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    if (EXIT_SUCCESS != display->open())
+        exit(EXIT_FAILURE);
+
+    memset(frame, 0x00, sizeof(frame));
+    const char *error = NULL;
+    while (NULL == error) {
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        if (poll(&pfd, 1, 1000 / 60) < 0 && errno != EINTR)
+            break;
+
+        if (pfd.revents & POLLIN) {
+            uint8_t msg[CHIP8E_STREAM_MSG_MAX];
+            ssize_t n = recv(fd, msg, sizeof(msg), 0);
+            if (n <= 0) {
+                error = "Stream closed.";
+                break;
+            }
+            if (chip8_stream_apply(frame, msg, n) < 0) {
+                error = "Malformed frame.";
+                break;
+            }
+            unpack(frame, video_buffer);
+            display->present(video_buffer);
+        } else if (pfd.revents & (POLLHUP | POLLERR)) {
+            error = "Stream closed.";
+            break;
+        }
+
+        uint16_t next;
+        if (display->input(&next) & CHIP8E_DISPLAY_QUIT)
+            break;
+        if (next != keys) {
+            uint8_t msg[CHIP8E_STREAM_KEYS_LEN] = { CHIP8E_STREAM_MSG_KEYS, next >> 8, next };
+            keys = next;
+            if (send(fd, msg, sizeof(msg), MSG_NOSIGNAL) < 0)
+                error = "Stream closed.";
+        }
+    }
+    display->close();
+    close(fd);
+    if (NULL != error) {
+        printf("%s\n", error);
+        result = EXIT_FAILURE;
+    }
+    return result;
+}
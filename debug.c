@@ -0,0 +1,228 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "chip8.h"
+#include "stack.h"
+#include "debug.h"
+
+static const char *break_names[] = {
+    [CHIP8E_BREAK_NONE] = "none",
+    [CHIP8E_BREAK_USER] = "user break",
+    [CHIP8E_BREAK_STEP] = "step",
+    [CHIP8E_BREAK_PC] = "breakpoint",
+    [CHIP8E_BREAK_READ] = "read watchpoint",
+    [CHIP8E_BREAK_WRITE] = "write watchpoint",
+    [CHIP8E_BREAK_REG] = "register condition"
+};
+
+void chip8_debug_attach(chip8_p chip, chip8_debug_p dbg)
+{
+    memset(dbg, 0x00, sizeof(*dbg));
+    chip->debug = dbg;
+}
+
+void chip8_debug_detach(chip8_p chip)
+{
+    chip->debug = NULL;
+}
+
+static bool chip8_debug_toggle(uint8_t *map, uint16_t addr)
+{
+    addr = CHIP8E_MEM_MASK(addr);
+    map[addr >> 3] ^= 1 << (addr & 0x7);
+    return CHIP8E_DEBUG_MAP_TEST(map, addr) != 0;
+}
+
+bool chip8_debug_toggle_break(chip8_debug_p dbg, uint16_t addr)
+{
+    return chip8_debug_toggle(dbg->breakpoints, addr);
+}
+
+bool chip8_debug_toggle_read(chip8_debug_p dbg, uint16_t addr)
+{
+    return chip8_debug_toggle(dbg->watch_read, addr);
+}
+
+bool chip8_debug_toggle_write(chip8_debug_p dbg, uint16_t addr)
+{
+    return chip8_debug_toggle(dbg->watch_write, addr);
+}
+
+void chip8_debug_break(chip8_p chip, chip8_break_t reason, uint16_t addr)
+{
+    // Traps and exit requests take precedence
+    if (chip->state != CHIP_STATE_NORMAL)
+        return;
+    chip->state = CHIP_STATE_BREAK;
+    if (chip->debug) {
+        chip->debug->reason = reason;
+        chip->debug->addr = addr;
+        chip->debug->step = false;
+    }
+}
+
+void chip8_debug_resume(chip8_p chip, bool step)
+{
+    if (chip->state != CHIP_STATE_BREAK)
+        return;
+    chip->state = CHIP_STATE_NORMAL;
+    if (chip->debug) {
+        chip->debug->reason = CHIP8E_BREAK_NONE;
+        chip->debug->step = step;
+        chip->debug->resume = true;
+    }
+}
+
+bool chip8_debug_fetch(chip8_p chip)
+{
+    chip8_debug_p dbg = chip->debug;
+
+    if (!dbg->resume && CHIP8E_DEBUG_MAP_TEST(dbg->breakpoints, chip->PC)) {
+        chip8_debug_break(chip, CHIP8E_BREAK_PC, chip->PC);
+        return true;
+    }
+    dbg->resume = false;
+    if (dbg->watch_change | dbg->watch_equal)
+        memcpy(dbg->V, chip->V, sizeof(dbg->V));
+    return false;
+}
+
+void chip8_debug_retire(chip8_p chip)
+{
+    chip8_debug_p dbg = chip->debug;
+
+    for (int r = 0; (dbg->watch_change | dbg->watch_equal) >> r; r++) {
+        uint16_t bit = 1 << r;
+        if (chip->V[r] == dbg->V[r])
+            continue;
+        if ((dbg->watch_change & bit) ||
+            ((dbg->watch_equal & bit) && chip->V[r] == dbg->watch_value[r])) {
+            chip8_debug_break(chip, CHIP8E_BREAK_REG, r);
+            break;
+        }
+    }
+    if (dbg->step)
+        chip8_debug_break(chip, CHIP8E_BREAK_STEP, chip->PC);
+}
+
+void chip8_debug_read(chip8_p chip, uint16_t addr)
+{
+    if (CHIP8E_DEBUG_MAP_TEST(chip->debug->watch_read, addr))
+        chip8_debug_break(chip, CHIP8E_BREAK_READ, addr);
+}
+
+void chip8_debug_write(chip8_p chip, uint16_t addr)
+{
+    if (CHIP8E_DEBUG_MAP_TEST(chip->debug->watch_write, addr))
+        chip8_debug_break(chip, CHIP8E_BREAK_WRITE, addr);
+}
+
+void chip8_debug_print(chip8_p chip)
+{
+    chip8_debug_p dbg = chip->debug;
+    if (NULL == dbg)
+        return;
+
+    switch (dbg->reason) {
+        case CHIP8E_BREAK_REG:
+            printf("Stopped at %04X: %s, V%X = %02x\n",
+                chip->PC, break_names[dbg->reason], dbg->addr, chip->V[dbg->addr]);
+        break;
+        case CHIP8E_BREAK_READ:
+        case CHIP8E_BREAK_WRITE:
+            printf("Stopped at %04X: %s, %04X = %02x\n",
+                chip->PC, break_names[dbg->reason], dbg->addr, chip->memory[dbg->addr]);
+        break;
+        default:
+            printf("Stopped at %04X: %s\n", chip->PC, break_names[dbg->reason]);
+        break;
+    }
+}
+
+static void chip8_debug_usage()
+{
+    printf("Commands:\n"
+    "\ts          - step one instruction.\n"
+    "\tc          - continue.\n"
+    "\tr          - registers.\n"
+    "\tk          - stack.\n"
+    "\tm [addr]   - memory dump, default at PC.\n"
+    "\tb addr     - toggle breakpoint.\n"
+    "\trw addr    - toggle read watchpoint.\n"
+    "\tww addr    - toggle write watchpoint.\n"
+    "\tvc x       - toggle break when Vx changes.\n"
+    "\tve x nn    - toggle break when Vx becomes nn.\n"
+    "\tq          - quit.\n");
+}
+
+void chip8_debug_console(chip8_p chip)
+{
+    chip8_debug_p dbg = chip->debug;
+    char line[64];
+    char cmd[16];
+    unsigned int a, b;
+
+    if (NULL == dbg)
+        return;
+    chip8_debug_print(chip);
+
+    while (chip->state == CHIP_STATE_BREAK) {
+        printf("(chip8) ");
+        fflush(stdout);
+        if (NULL == fgets(line, sizeof(line), stdin)) {
+            chip->state = CHIP_STATE_EXIT;
+            break;
+        }
+
+        int n = sscanf(line, "%15s %x %x", cmd, &a, &b);
+        if (n < 1)
+            continue;
+
+        if (!strcmp(cmd, "s")) {
+            chip8_debug_resume(chip, true);
+        } else
+        if (!strcmp(cmd, "c")) {
+            chip8_debug_resume(chip, false);
+        } else
+        if (!strcmp(cmd, "r")) {
+            chip8_print_registers(chip);
+        } else
+        if (!strcmp(cmd, "k")) {
+            chip8_stack_print(chip);
+        } else
+        if (!strcmp(cmd, "m")) {
+            chip8_memdump(chip, (n > 1) ? a : chip->PC);
+        } else
+        if (!strcmp(cmd, "b") && n > 1) {
+            printf("Breakpoint %04X %s.\n", CHIP8E_MEM_MASK(a),
+                chip8_debug_toggle_break(dbg, a) ? "set" : "cleared");
+        } else
+        if (!strcmp(cmd, "rw") && n > 1) {
+            printf("Read watchpoint %04X %s.\n", CHIP8E_MEM_MASK(a),
+                chip8_debug_toggle_read(dbg, a) ? "set" : "cleared");
+        } else
+        if (!strcmp(cmd, "ww") && n > 1) {
+            printf("Write watchpoint %04X %s.\n", CHIP8E_MEM_MASK(a),
+                chip8_debug_toggle_write(dbg, a) ? "set" : "cleared");
+        } else
+        if (!strcmp(cmd, "vc") && n > 1) {
+            dbg->watch_change ^= 1 << CHIP8E_REG_MASK(a);
+            printf("Change condition on V%X %s.\n", CHIP8E_REG_MASK(a),
+                (dbg->watch_change & (1 << CHIP8E_REG_MASK(a))) ? "set" : "cleared");
+        } else
+        if (!strcmp(cmd, "ve") && n > 2) {
+            dbg->watch_equal ^= 1 << CHIP8E_REG_MASK(a);
+            dbg->watch_value[CHIP8E_REG_MASK(a)] = b;
+            printf("Condition V%X == %02x %s.\n", CHIP8E_REG_MASK(a), b & 0xFF,
+                (dbg->watch_equal & (1 << CHIP8E_REG_MASK(a))) ? "set" : "cleared");
+        } else
+        if (!strcmp(cmd, "q")) {
+            chip->state = CHIP_STATE_EXIT;
+        } else {
+            chip8_debug_usage();
+        }
+    }
+}
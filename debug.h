@@ -0,0 +1,78 @@
+#ifndef __DEBUG_H
+#define __DEBUG_H
+
+#include "chip8.h"
+
+/**
+ * Debugger for the CHIP8 core.
+ *
+ * Breakpoints and watchpoints are kept in per-address bitmaps, so a check
+ * in the fetch or store path is a single bit test. The core only looks at
+ * them while a debugger is attached (chip->debug != NULL), a machine
+ * without one pays a pointer test per cycle.
+ *
+ * A hit stops the machine with state CHIP_STATE_BREAK. PC breakpoints stop
+ * before the instruction executes, watchpoints and register conditions
+ * after it has retired.
+ **/
+
+#define CHIP8E_DEBUG_MAP_SIZE (CHIP8E_MEM_SIZE / 8)
+#define CHIP8E_DEBUG_MAP_TEST(map, a) ((map)[CHIP8E_MEM_MASK(a) >> 3] & (1 << ((a) & 0x7)))
+
+typedef enum {
+    CHIP8E_BREAK_NONE,
+    CHIP8E_BREAK_USER,
+    CHIP8E_BREAK_STEP,
+    CHIP8E_BREAK_PC,
+    CHIP8E_BREAK_READ,
+    CHIP8E_BREAK_WRITE,
+    CHIP8E_BREAK_REG
+} chip8_break_t;
+
+typedef struct chip8_debug {
+    uint8_t breakpoints[CHIP8E_DEBUG_MAP_SIZE];
+    uint8_t watch_read[CHIP8E_DEBUG_MAP_SIZE];
+    uint8_t watch_write[CHIP8E_DEBUG_MAP_SIZE];
+    // Break when a register in the mask changes
+    uint16_t watch_change;
+    // Break when a register in the mask becomes equal to watch_value
+    uint16_t watch_equal;
+    uint8_t watch_value[16];
+    // Register values before the current instruction
+    uint8_t V[16];
+    // Break after the next instruction
+    bool step;
+    // Ignore the breakpoint at PC once, set when resuming from it
+    bool resume;
+    // Why and where the machine stopped
+    chip8_break_t reason;
+    uint16_t addr;
+} chip8_debug_t, *chip8_debug_p;
+
+// Attach a cleared debugger to the machine
+void chip8_debug_attach(chip8_p chip, chip8_debug_p dbg);
+void chip8_debug_detach(chip8_p chip);
+
+// Toggle breakpoints and watchpoints, return the new state
+bool chip8_debug_toggle_break(chip8_debug_p dbg, uint16_t addr);
+bool chip8_debug_toggle_read(chip8_debug_p dbg, uint16_t addr);
+bool chip8_debug_toggle_write(chip8_debug_p dbg, uint16_t addr);
+
+// Stop the machine, e.g. from a frontend hotkey
+void chip8_debug_break(chip8_p chip, chip8_break_t reason, uint16_t addr);
+// Leave the break state, optionally stopping again after one instruction
+void chip8_debug_resume(chip8_p chip, bool step);
+
+// Core hooks, only called while a debugger is attached.
+// Fetch returns true when the instruction at PC must not execute.
+bool chip8_debug_fetch(chip8_p chip);
+void chip8_debug_retire(chip8_p chip);
+void chip8_debug_read(chip8_p chip, uint16_t addr);
+void chip8_debug_write(chip8_p chip, uint16_t addr);
+
+// Print why the machine stopped
+void chip8_debug_print(chip8_p chip);
+// Interactive console on stdin, returns when the machine should run again
+void chip8_debug_console(chip8_p chip);
+
+#endif // __DEBUG_H
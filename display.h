@@ -0,0 +1,55 @@
+#ifndef __DISPLAY_H
+#define __DISPLAY_H
+
+#include "chip8.h"
+#include "scale.h"
+
+/**
+ * Display backends.
+ *
+ * A backend shows the video buffer and reads the keypad. The frontend
+ * calls input() and present() once per frame, present() only when the
+ * video buffer changed. Backends keep their state to themselves, there
+ * is at most one display per process.
+ *
+ * chip8_display_sdl draws into a window and needs SDL, it is linked into
+ * chip8e only. It upscales on the CPU with one of the scale.h filters into
+ * a streaming texture and draws that with a single copy.
+ * chip8_display_term draws with ANSI escape sequences on the controlling
+ * terminal, so it works over SSH and without X.
+ *
+ * Backends that can show many machines at once implement present_grid():
+ * every video buffer becomes a tile of one frame and the tile that
+ * receives the keypad is outlined. A click on a tile makes input() return
+ * CHIP8E_DISPLAY_PICK and picked() tells which one.
+ **/
+
+// Events returned by input()
+#define CHIP8E_DISPLAY_QUIT  0x01
+// The user asked for the debugger
+#define CHIP8E_DISPLAY_BREAK 0x02
+// Grid: a tile was clicked, or the next one asked for with Tab
+#define CHIP8E_DISPLAY_PICK  0x04
+#define CHIP8E_DISPLAY_NEXT  0x08
+
+typedef struct {
+    const char *name;
+    int (*open)(void);
+    // Update the keypad mask, returns CHIP8E_DISPLAY_* events
+    int (*input)(uint16_t *keys);
+    void (*present)(const uint8_t *video_buffer);
+    void (*close)(void);
+    // Grid of count machines, only buffers flagged dirty are redrawn.
+    // NULL if the backend shows a single machine
+    void (*present_grid)(const uint8_t *const *video_buffers, const bool *dirty,
+        int count, int selected);
+    int (*picked)(void);
+} chip8_display_t, *chip8_display_p;
+
+extern const chip8_display_t chip8_display_sdl;
+extern const chip8_display_t chip8_display_term;
+
+// Upscaling filter of the SDL display, before open()
+void chip8_display_sdl_filter(chip8_scale_filter_t filter);
+
+#endif // __DISPLAY_H
@@ -0,0 +1,323 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <SDL.h>
+
+#include "chip8.h"
+#include "display.h"
+#include "scale.h"
+#include "grid.h"
+
+// Lit and unlit pixels, ARGB
+#define CHIP8E_SDL_ON  0xFF404040
+#define CHIP8E_SDL_OFF 0xFF808080
+// Grid: gaps between tiles and the outline of the selected one
+#define CHIP8E_SDL_GAP    0xFF000000
+#define CHIP8E_SDL_SELECT 0xFFE0A000
+
+static SDL_Window *window;
+static SDL_Renderer *renderer;
+// Streaming texture at the scaled size, recreated when the window is
+// resized to another factor
+static SDL_Texture *texture;
+static int texture_w, texture_h;
+static chip8_scale_filter_t filter = CHIP8E_SCALE_NEAREST;
+
+// Grid: every machine is a tile of one atlas, one texel per pixel, that
+// the renderer scales in a single copy. The atlas is kept in host memory
+// with the last image of every tile: only tiles whose image changed are
+// converted, and one upload covers the rows that hold them. The layout
+// is grid.c's.
+static uint32_t *atlas;
+static uint8_t (*shown)[CHIP8E_XRES * CHIP8E_YRES];
+static SDL_Texture *atlas_texture;
+static chip8_grid_t grid;
+static int atlas_selected = -1;
+static int picked = -1;
+
+// Host keys for the hex keypad, indexed by CHIP8 key value
+static const SDL_Keycode keymap[CHIP8E_KEY_COUNT] = {
+    SDLK_x, SDLK_1, SDLK_2, SDLK_3,
+    SDLK_q, SDLK_w, SDLK_e, SDLK_a,
+    SDLK_s, SDLK_d, SDLK_z, SDLK_c,
+    SDLK_4, SDLK_r, SDLK_f, SDLK_v
+};
+
+static void update_keys(uint16_t *keys, SDL_Keycode sym, bool down)
+{
+    for (int k = 0; k < CHIP8E_KEY_COUNT; k++) {
+        if (keymap[k] != sym)
+            continue;
+        if (down)
+            *keys |= CHIP8E_KEY_BIT(k);
+        else
+            *keys &= ~CHIP8E_KEY_BIT(k);
+    }
+}
+
+void chip8_display_sdl_filter(chip8_scale_filter_t f)
+{
+    filter = f;
+}
+
+static int chip8_display_sdl_open(void)
+{
+  if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+        printf("SDL Initialization failed:%s.\n", SDL_GetError());
+        return EXIT_FAILURE;
+    }
+
+    window = SDL_CreateWindow("Hello, World!",
+        100, 100, 640, 320, SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
+    if (window == NULL) {
+            printf("SDL Window creation failed: %s.\n",  SDL_GetError());
+            SDL_Quit();
+            return EXIT_FAILURE;
+    }
+
+    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED|SDL_RENDERER_PRESENTVSYNC);
+    if (renderer == NULL) {
+            printf("SDL Renderer creation failed: %s.\n",  SDL_GetError());
+            SDL_DestroyWindow(window);
+            SDL_Quit();
+            return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+// Tile under a point of the window, -1 for none
+static int grid_tile_at(int x, int y)
+{
+    int win_w, win_h, out_w, out_h;
+    SDL_GetWindowSize(window, &win_w, &win_h);
+    SDL_GetRendererOutputSize(renderer, &out_w, &out_h);
+    // Window coordinates differ from pixels on high DPI displays
+    if (win_w > 0 && win_h > 0) {
+        x = x * out_w / win_w;
+        y = y * out_h / win_h;
+    }
+    return chip8_grid_tile_at(&grid, x, y);
+}
+
+// Drains the whole queue: a key release queued behind other events must
+// not be lost, or the key stays held
+static int chip8_display_sdl_input(uint16_t *keys)
+{
+    int events = 0;
+    SDL_Event event;
+    while (SDL_PollEvent(&event)) {
+        switch (event.type) {
+            case SDL_QUIT:
+                printf("Quit event.\n");
+                events |= CHIP8E_DISPLAY_QUIT;
+            break;
+            case SDL_KEYDOWN:
+            case SDL_KEYUP:
+                switch (event.key.keysym.sym) {
+                    case SDLK_ESCAPE:
+                        events |= CHIP8E_DISPLAY_QUIT;
+                    break;
+                    case SDLK_F1:
+                        if (event.type == SDL_KEYDOWN)
+                            events |= CHIP8E_DISPLAY_BREAK;
+                    break;
+                    case SDLK_TAB:
+                        if (event.type == SDL_KEYDOWN)
+                            events |= CHIP8E_DISPLAY_NEXT;
+                    break;
+                    default:
+                        update_keys(keys, event.key.keysym.sym,
+                            event.type == SDL_KEYDOWN);
+                    break;
+                }
+            break;
+            case SDL_MOUSEBUTTONDOWN:
+                if (grid.count && event.button.button == SDL_BUTTON_LEFT) {
+                    picked = grid_tile_at(event.button.x, event.button.y);
+                    if (picked >= 0)
+                        events |= CHIP8E_DISPLAY_PICK;
+                }
+            break;
+            default:
+            break;
+        }
+    }
+    return events;
+}
+
+static void chip8_display_sdl_present(const uint8_t *video_buffer)
+{
+    int out_w, out_h;
+    void *pixels;
+    int pitch;
+
+    SDL_GetRendererOutputSize(renderer, &out_w, &out_h);
+    int factor = chip8_scale_factor(filter, CHIP8E_XRES, CHIP8E_YRES, out_w, out_h);
+    int w = CHIP8E_XRES * factor, h = CHIP8E_YRES * factor;
+
+    if (NULL == texture || w != texture_w || h != texture_h) {
+        if (texture)
+            SDL_DestroyTexture(texture);
+        texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+            SDL_TEXTUREACCESS_STREAMING, w, h);
+        if (NULL == texture) {
+            printf("SDL Texture creation failed: %s.\n", SDL_GetError());
+            return;
+        }
+        texture_w = w;
+        texture_h = h;
+    }
+
+    if (SDL_LockTexture(texture, NULL, &pixels, &pitch) != 0)
+        return;
+    chip8_scale(filter, video_buffer, CHIP8E_XRES, CHIP8E_YRES, factor,
+        pixels, pitch, CHIP8E_SDL_ON, CHIP8E_SDL_OFF);
+    SDL_UnlockTexture(texture);
+
+    // Centered, the border stays black
+    SDL_Rect dst = { (out_w - w) / 2, (out_h - h) / 2, w, h };
+    SDL_SetRenderDrawColor(renderer, 0x00, 0x00, 0x00, 0xFF);
+    SDL_RenderClear(renderer);
+    SDL_RenderCopy(renderer, texture, NULL, &dst);
+    SDL_RenderPresent(renderer);
+}
+
+// Lay the grid out again for a new count or output size, true if the
+// atlas was rebuilt and every tile has to be drawn
+static bool grid_layout(int count, int out_w, int out_h)
+{
+    if (count == grid.count && out_w == grid.out_w && out_h == grid.out_h)
+        return false;
+
+    chip8_grid_t next;
+    chip8_grid_layout(&next, count, out_w, out_h);
+    if (next.w != grid.w || next.h != grid.h || NULL == atlas_texture) {
+        // A tile for every cell, the count may grow within the same size
+        int cells = next.cols * ((next.h - CHIP8E_GRID_GAP) / CHIP8E_GRID_TILE_H);
+        if (atlas_texture)
+            SDL_DestroyTexture(atlas_texture);
+        free(atlas);
+        atlas = malloc((size_t)next.w * next.h * sizeof(uint32_t));
+        free(shown);
+        shown = malloc((size_t)cells * sizeof(*shown));
+        atlas_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+            SDL_TEXTUREACCESS_STREAMING, next.w, next.h);
+        if (NULL == atlas || NULL == shown || NULL == atlas_texture) {
+            printf("SDL Texture creation failed: %s.\n", SDL_GetError());
+            grid.count = 0;
+            return false;
+        }
+    }
+    for (int i = 0; i < next.w * next.h; i++)
+        atlas[i] = CHIP8E_SDL_GAP;
+    grid = next;
+    atlas_selected = -1;
+    return true;
+}
+
+static uint32_t *grid_tile(int tile)
+{
+    int x = CHIP8E_GRID_GAP + tile % grid.cols * CHIP8E_GRID_TILE_W;
+    int y = CHIP8E_GRID_GAP + tile / grid.cols * CHIP8E_GRID_TILE_H;
+    return atlas + (size_t)y * grid.w + x;
+}
+
+// Frame a tile in the gap around it
+static void grid_outline(int tile, uint32_t color)
+{
+    if (tile < 0 || tile >= grid.count)
+        return;
+    uint32_t *top = grid_tile(tile) - grid.w - 1;
+    uint32_t *bottom = top + (size_t)(CHIP8E_YRES + 1) * grid.w;
+    for (int x = 0; x < CHIP8E_XRES + 2; x++)
+        top[x] = bottom[x] = color;
+    for (int y = 1; y <= CHIP8E_YRES; y++)
+        top[(size_t)y * grid.w] = top[(size_t)y * grid.w + CHIP8E_XRES + 1] = color;
+}
+
+static void chip8_display_sdl_present_grid(const uint8_t *const *video_buffers,
+    const bool *dirty, int count, int selected)
+{
+    int out_w, out_h;
+    // Tile rows to upload
+    int first = grid.h, last = -1;
+
+    SDL_GetRendererOutputSize(renderer, &out_w, &out_h);
+    bool full = grid_layout(count, out_w, out_h);
+    if (0 == grid.count)
+        return;
+
+    for (int i = 0; i < count; i++) {
+        // DRW sets dirty even when it redraws the same image
+        if (!full && (!dirty[i] || !memcmp(shown[i], video_buffers[i], sizeof(shown[i]))))
+            continue;
+        memcpy(shown[i], video_buffers[i], sizeof(shown[i]));
+        chip8_scale(CHIP8E_SCALE_NEAREST, video_buffers[i], CHIP8E_XRES, CHIP8E_YRES, 1,
+            grid_tile(i), grid.w * sizeof(uint32_t), CHIP8E_SDL_ON, CHIP8E_SDL_OFF);
+        first = (i / grid.cols < first) ? i / grid.cols : first;
+        last = (i / grid.cols > last) ? i / grid.cols : last;
+    }
+    if (selected != atlas_selected) {
+        int tiles[2] = { atlas_selected, selected };
+        grid_outline(atlas_selected, CHIP8E_SDL_GAP);
+        grid_outline(selected, CHIP8E_SDL_SELECT);
+        atlas_selected = selected;
+        for (int t = 0; t < 2; t++) {
+            if (tiles[t] < 0 || tiles[t] >= count)
+                continue;
+            first = (tiles[t] / grid.cols < first) ? tiles[t] / grid.cols : first;
+            last = (tiles[t] / grid.cols > last) ? tiles[t] / grid.cols : last;
+        }
+    }
+
+    if (full) {
+        SDL_UpdateTexture(atlas_texture, NULL, atlas, grid.w * sizeof(uint32_t));
+    } else if (last >= 0) {
+        // Whole tile rows with the gaps around them
+        SDL_Rect rows = { 0, first * CHIP8E_GRID_TILE_H, grid.w,
+            (last - first + 1) * CHIP8E_GRID_TILE_H + CHIP8E_GRID_GAP };
+        SDL_UpdateTexture(atlas_texture, &rows, atlas + (size_t)rows.y * grid.w,
+            grid.w * sizeof(uint32_t));
+    }
+    SDL_SetRenderDrawColor(renderer, 0x00, 0x00, 0x00, 0xFF);
+    SDL_RenderClear(renderer);
+    SDL_Rect dst = { grid.dst_x, grid.dst_y, grid.dst_w, grid.dst_h };
+    SDL_RenderCopy(renderer, atlas_texture, NULL, &dst);
+    SDL_RenderPresent(renderer);
+}
+
+static int chip8_display_sdl_picked(void)
+{
+    return picked;
+}
+
+static void chip8_display_sdl_close(void)
+{
+    if (texture)
+        SDL_DestroyTexture(texture);
+    texture = NULL;
+    if (atlas_texture)
+        SDL_DestroyTexture(atlas_texture);
+    atlas_texture = NULL;
+    free(atlas);
+    atlas = NULL;
+    free(shown);
+    shown = NULL;
+    grid.count = 0;
+    SDL_DestroyRenderer(renderer);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+}
+
+const chip8_display_t chip8_display_sdl = {
+    "sdl",
+    chip8_display_sdl_open,
+    chip8_display_sdl_input,
+    chip8_display_sdl_present,
+    chip8_display_sdl_close,
+    chip8_display_sdl_present_grid,
+    chip8_display_sdl_picked
+};
@@ -0,0 +1,201 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <termios.h>
+
+#include "chip8.h"
+#include "display.h"
+
+/**
+ * ANSI terminal display.
+ *
+ * Each character cell holds two pixel rows as a half block glyph, the
+ * screen is 64x16 cells. Only cells that differ from the last frame are
+ * written, and the whole frame goes out in one write(). Output and input
+ * use the controlling terminal rather than stdout, so traces can be
+ * redirected without disturbing the picture.
+ *
+ * Terminals report key presses but no releases, a key counts as held for
+ * CHIP8E_TERM_HOLD_MS after each press or autorepeat.
+ **/
+
+#define CHIP8E_TERM_ROWS (CHIP8E_YRES / 2)
+#define CHIP8E_TERM_HOLD_MS 150
+// Unchanged cells are rewritten rather than jumped over when the gap is
+// at most this wide, a cursor move costs more bytes
+#define CHIP8E_TERM_MAX_GAP 2
+// Cell, glyph and worst case cursor move per cell, plus frame overhead
+#define CHIP8E_TERM_BUF_SIZE (CHIP8E_XRES * CHIP8E_TERM_ROWS * 12 + 64)
+
+// Indexed by bottom << 1 | top
+static const char *glyphs[4] = {
+    " ", "\xe2\x96\x80", "\xe2\x96\x84", "\xe2\x96\x88"
+};
+
+// Same layout as the SDL display
+static const char keymap[CHIP8E_KEY_COUNT] = {
+    'x', '1', '2', '3',
+    'q', 'w', 'e', 'a',
+    's', 'd', 'z', 'c',
+    '4', 'r', 'f', 'v'
+};
+
+static int tty = -1;
+static struct termios saved_tio;
+// Cells on screen, 0xFF when unknown
+static uint8_t cells[CHIP8E_TERM_ROWS][CHIP8E_XRES];
+static uint64_t held[CHIP8E_KEY_COUNT];
+// Keys this backend set in the keypad mask, stream viewers own the rest
+static uint16_t term_keys;
+static char out[CHIP8E_TERM_BUF_SIZE];
+
+static uint64_t chip8_display_term_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void chip8_display_term_write(const char *buf, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = write(tty, buf, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return;
+        }
+        buf += n;
+        len -= n;
+    }
+}
+
+static int chip8_display_term_open(void)
+{
+    struct termios tio;
+
+    tty = open("/dev/tty", O_RDWR | O_NOCTTY);
+    if (tty < 0) {
+        printf("No terminal: %s.\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (tcgetattr(tty, &saved_tio) < 0) {
+        printf("Cannot read terminal settings: %s.\n", strerror(errno));
+        close(tty);
+        tty = -1;
+        return EXIT_FAILURE;
+    }
+    // No line buffering, echo or signals, reads return at once
+    tio = saved_tio;
+    tio.c_lflag &= ~(ICANON | ECHO | ISIG);
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    tcsetattr(tty, TCSANOW, &tio);
+
+    memset(cells, 0xFF, sizeof(cells));
+    memset(held, 0x00, sizeof(held));
+    term_keys = 0;
+    // Hide the cursor, clear the screen
+    chip8_display_term_write("\x1b[?25l\x1b[2J", 10);
+    return EXIT_SUCCESS;
+}
+
+static int chip8_display_term_input(uint16_t *keys)
+{
+    int events = 0;
+    uint64_t now = chip8_display_term_ms();
+    char buf[64];
+    ssize_t n;
+
+    while ((n = read(tty, buf, sizeof(buf))) > 0) {
+        for (ssize_t i = 0; i < n; i++) {
+            // Ctrl-C, or Esc on its own rather than starting a sequence
+            if (0x03 == buf[i] || (0x1b == buf[i] && i + 1 == n)) {
+                events |= CHIP8E_DISPLAY_QUIT;
+                continue;
+            }
+            // Skip escape sequences, arrows and function keys
+            if (0x1b == buf[i]) {
+                for (i += 2; i < n && (buf[i] < 0x40 || buf[i] > 0x7E); i++)
+                    ;
+                continue;
+            }
+            for (int k = 0; k < CHIP8E_KEY_COUNT; k++)
+                if (keymap[k] == buf[i])
+                    held[k] = now + CHIP8E_TERM_HOLD_MS;
+        }
+    }
+
+    uint16_t old = term_keys;
+    term_keys = 0;
+    for (int k = 0; k < CHIP8E_KEY_COUNT; k++)
+        if (held[k] > now)
+            term_keys |= CHIP8E_KEY_BIT(k);
+    // Swap only our share, as chip8_stream_update_keys() does for viewers
+    *keys = (*keys & ~old) | term_keys;
+    return events;
+}
+
+static void chip8_display_term_present(const uint8_t *video_buffer)
+{
+    size_t len = 0;
+
+    for (int row = 0; row < CHIP8E_TERM_ROWS; row++) {
+        const uint8_t *top = video_buffer + (2 * row) * CHIP8E_XRES;
+        const uint8_t *bottom = top + CHIP8E_XRES;
+        // Column the cursor is at in this row, -1 if elsewhere
+        int cursor = -1;
+
+        for (int x = 0; x < CHIP8E_XRES; x++) {
+            uint8_t cell = (bottom[x] & 0x1) << 1 | (top[x] & 0x1);
+            if (cell == cells[row][x])
+                continue;
+
+            if (cursor >= 0 && x - cursor <= CHIP8E_TERM_MAX_GAP) {
+                for (; cursor < x; cursor++) {
+                    const char *g = glyphs[cells[row][cursor]];
+                    memcpy(out + len, g, strlen(g));
+                    len += strlen(g);
+                }
+            } else if (cursor != x) {
+                len += sprintf(out + len, "\x1b[%d;%dH", row + 1, x + 1);
+            }
+            memcpy(out + len, glyphs[cell], strlen(glyphs[cell]));
+            len += strlen(glyphs[cell]);
+            cells[row][x] = cell;
+            cursor = x + 1;
+        }
+    }
+    if (len > 0)
+        chip8_display_term_write(out, len);
+}
+
+static void chip8_display_term_close(void)
+{
+    char buf[32];
+
+    if (tty < 0)
+        return;
+    // Below the picture, cursor back on
+    int len = sprintf(buf, "\x1b[%dH\x1b[?25h\n", CHIP8E_TERM_ROWS + 1);
+    chip8_display_term_write(buf, len);
+    tcsetattr(tty, TCSANOW, &saved_tio);
+    close(tty);
+    tty = -1;
+}
+
+const chip8_display_t chip8_display_term = {
+    "term",
+    chip8_display_term_open,
+    chip8_display_term_input,
+    chip8_display_term_present,
+    chip8_display_term_close,
+    NULL,
+    NULL
+};
@@ -0,0 +1,326 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "chip8.h"
+#include "timing.h"
+#include "explore.h"
+
+#define CHIP8E_EXPLORE_BITMAP ((CHIP8E_EXPLORE_BLOCKS + 7) / 8)
+
+// New states found by one worker during a level
+typedef struct {
+    chip8_explore_p ex;
+    chip8_explore_state_t *found;
+    uint32_t count, capacity;
+    uint64_t forks, exceptions;
+    uint8_t coverage[CHIP8E_MEM_SIZE / 8];
+} chip8_explore_worker_t;
+
+static int chip8_hashset_init(chip8_hashset_t *set, uint64_t entries)
+{
+    uint64_t size = 1024;
+    // At most half full
+    while (size < 2 * entries)
+        size <<= 1;
+    set->slots = calloc(size, sizeof(uint64_t));
+    set->mask = size - 1;
+    set->count = 0;
+    return (NULL == set->slots) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+// True if h was not in the set yet
+static bool chip8_hashset_insert(chip8_hashset_t *set, uint64_t h)
+{
+    if (0 == h)
+        h = 1;
+    for (uint64_t i = h & set->mask;; i = (i + 1) & set->mask) {
+        uint64_t cur = __atomic_load_n(&set->slots[i], __ATOMIC_ACQUIRE);
+        if (cur == h)
+            return false;
+        if (0 == cur) {
+            if (__atomic_compare_exchange_n(&set->slots[i], &cur, h, false,
+                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                __atomic_fetch_add(&set->count, 1, __ATOMIC_RELAXED);
+                return true;
+            }
+            // Lost the slot, cur is what the winner put there
+            if (cur == h)
+                return false;
+        }
+    }
+}
+
+static void chip8_explore_capture(chip8_p chip, chip8_image_t *image)
+{
+    memset(image, 0x00, sizeof(*image));
+    memcpy(image->memory, chip->memory, sizeof(image->memory));
+    memcpy(image->video_buffer, chip->video_buffer, sizeof(image->video_buffer));
+    memcpy(image->stack, chip->stack, sizeof(image->stack));
+    memcpy(image->V, chip->V, sizeof(image->V));
+    image->I = chip->I;
+    image->PC = chip->PC;
+    image->SP = chip->SP;
+    image->DT = chip->DT;
+    image->ST = chip->ST;
+    image->seed = chip->seed;
+    image->phase = chip->next_frame - chip->cycles;
+}
+
+void chip8_explore_restore(const chip8_image_t *image, chip8_p chip)
+{
+    chip8_init(chip);
+    chip8_timing_init(chip, CHIP8E_TIMING_VIP, 0);
+    memcpy(chip->memory, image->memory, sizeof(image->memory));
+    memcpy(chip->video_buffer, image->video_buffer, sizeof(image->video_buffer));
+    memcpy(chip->stack, image->stack, sizeof(image->stack));
+    memcpy(chip->V, image->V, sizeof(image->V));
+    chip->I = image->I;
+    chip->PC = image->PC;
+    chip->SP = image->SP;
+    chip->DT = image->DT;
+    chip->ST = image->ST;
+    chip->seed = image->seed;
+    chip->next_frame = chip->cycles + image->phase;
+}
+
+// Bitmap of changed blocks followed by their contents
+static uint8_t *chip8_explore_delta(const chip8_image_t *from, const chip8_image_t *to,
+    uint32_t *size)
+{
+    const uint8_t *a = (const uint8_t *)from, *b = (const uint8_t *)to;
+    uint8_t buf[CHIP8E_EXPLORE_BITMAP + sizeof(chip8_image_t)];
+    uint32_t len = CHIP8E_EXPLORE_BITMAP;
+
+    memset(buf, 0x00, CHIP8E_EXPLORE_BITMAP);
+    for (size_t blk = 0; blk < CHIP8E_EXPLORE_BLOCKS; blk++) {
+        size_t off = blk * CHIP8E_EXPLORE_BLOCK;
+        size_t n = (off + CHIP8E_EXPLORE_BLOCK > sizeof(chip8_image_t))
+            ? sizeof(chip8_image_t) - off : CHIP8E_EXPLORE_BLOCK;
+        if (!memcmp(a + off, b + off, n))
+            continue;
+        buf[blk / 8] |= 1 << (blk % 8);
+        memcpy(buf + len, b + off, n);
+        len += n;
+    }
+    uint8_t *data = malloc(len);
+    if (data)
+        memcpy(data, buf, len);
+    *size = len;
+    return data;
+}
+
+static void chip8_explore_apply(chip8_image_t *image, const uint8_t *delta)
+{
+    uint8_t *p = (uint8_t *)image;
+    const uint8_t *src = delta + CHIP8E_EXPLORE_BITMAP;
+    for (size_t blk = 0; blk < CHIP8E_EXPLORE_BLOCKS; blk++) {
+        if (!(delta[blk / 8] & (1 << (blk % 8))))
+            continue;
+        size_t off = blk * CHIP8E_EXPLORE_BLOCK;
+        size_t n = (off + CHIP8E_EXPLORE_BLOCK > sizeof(chip8_image_t))
+            ? sizeof(chip8_image_t) - off : CHIP8E_EXPLORE_BLOCK;
+        memcpy(p + off, src, n);
+        src += n;
+    }
+}
+
+static bool chip8_explore_is_key(uint16_t depth)
+{
+    return 0 == depth % CHIP8E_EXPLORE_KEY_DEPTH;
+}
+
+void chip8_explore_image(chip8_explore_p ex, uint32_t index, chip8_image_t *image)
+{
+    uint32_t chain[CHIP8E_EXPLORE_KEY_DEPTH];
+    int n = 0;
+
+    while (!chip8_explore_is_key(ex->states[index].depth)) {
+        chain[n++] = index;
+        index = ex->states[index].parent;
+    }
+    memcpy(image, ex->states[index].data, sizeof(*image));
+    while (n > 0)
+        chip8_explore_apply(image, ex->states[chain[--n]].data);
+}
+
+static bool chip8_explore_store(chip8_explore_worker_t *w, uint32_t parent, uint16_t depth,
+    uint8_t input, const chip8_image_t *from, const chip8_image_t *to)
+{
+    if (w->count == w->capacity) {
+        uint32_t capacity = w->capacity ? 2 * w->capacity : 256;
+        chip8_explore_state_t *found = realloc(w->found, capacity * sizeof(*found));
+        if (NULL == found)
+            return false;
+        w->found = found;
+        w->capacity = capacity;
+    }
+    chip8_explore_state_t *st = &w->found[w->count];
+    st->parent = parent;
+    st->depth = depth;
+    st->input = input;
+    if (chip8_explore_is_key(depth)) {
+        st->size = sizeof(*to);
+        st->data = malloc(sizeof(*to));
+        if (st->data)
+            memcpy(st->data, to, sizeof(*to));
+    } else {
+        st->data = chip8_explore_delta(from, to, &st->size);
+    }
+    if (NULL == st->data)
+        return false;
+    w->count++;
+    return true;
+}
+
+// One frame from the current state, marking every PC it executes
+static void chip8_explore_frame(chip8_p chip, uint8_t *coverage)
+{
+    uint64_t frame = chip->frames;
+    while (chip->state == CHIP_STATE_NORMAL && chip->frames == frame) {
+        uint16_t pc = CHIP8E_MEM_MASK(chip->PC);
+        coverage[pc >> 3] |= 1 << (pc & 0x7);
+        chip8_cycle(chip);
+    }
+}
+
+static void *chip8_explore_worker(void *arg)
+{
+    chip8_explore_worker_t *w = arg;
+    chip8_explore_p ex = w->ex;
+    chip8_image_t parent, child;
+    chip8_t chip;
+    uint32_t i;
+
+    while ((i = __atomic_fetch_add(&ex->cursor, 1, __ATOMIC_RELAXED)) < ex->frontier_count) {
+        uint32_t index = ex->frontier[i];
+        chip8_explore_image(ex, index, &parent);
+
+        for (uint8_t input = 0; input < CHIP8E_EXPLORE_INPUTS; input++) {
+            if (__atomic_load_n(&ex->seen.count, __ATOMIC_RELAXED) >= ex->max_states)
+                return NULL;
+            chip8_explore_restore(&parent, &chip);
+            chip.keys = input ? CHIP8E_KEY_BIT(input - 1) : 0;
+            chip8_explore_frame(&chip, w->coverage);
+            w->forks++;
+            if (chip.state != CHIP_STATE_NORMAL) {
+                w->exceptions++;
+                continue;
+            }
+
+            chip8_explore_capture(&chip, &child);
+            if (!chip8_hashset_insert(&ex->seen, chip8_hash(&child, sizeof(child))))
+                continue;
+            chip8_hashset_insert(&ex->frames,
+                chip8_hash(child.video_buffer, sizeof(child.video_buffer)));
+            if (!chip8_explore_store(w, index, ex->depth + 1, input, &parent, &child)) {
+                printf("Out of memory.\n");
+                return NULL;
+            }
+        }
+    }
+    return NULL;
+}
+
+int chip8_explore_init(chip8_explore_p ex, chip8_p chip, int threads,
+    uint32_t max_states, uint16_t max_depth)
+{
+    chip8_image_t root;
+
+    memset(ex, 0x00, sizeof(*ex));
+    ex->threads = (threads < 1) ? 1 :
+        (threads > CHIP8E_EXPLORE_MAX_THREADS) ? CHIP8E_EXPLORE_MAX_THREADS : threads;
+    ex->max_states = max_states;
+    ex->max_depth = max_depth;
+    if (EXIT_SUCCESS != chip8_hashset_init(&ex->seen, max_states + ex->threads)
+        || EXIT_SUCCESS != chip8_hashset_init(&ex->frames, max_states + ex->threads))
+        return EXIT_FAILURE;
+
+    chip8_timing_init(chip, CHIP8E_TIMING_VIP, 0);
+    chip8_explore_capture(chip, &root);
+    ex->states = malloc(sizeof(*ex->states));
+    ex->frontier = malloc(sizeof(*ex->frontier));
+    if (NULL == ex->states || NULL == ex->frontier)
+        return EXIT_FAILURE;
+    ex->states[0].parent = 0;
+    ex->states[0].depth = 0;
+    ex->states[0].input = 0;
+    ex->states[0].size = sizeof(root);
+    ex->states[0].data = malloc(sizeof(root));
+    if (NULL == ex->states[0].data)
+        return EXIT_FAILURE;
+    memcpy(ex->states[0].data, &root, sizeof(root));
+    ex->state_count = 1;
+    ex->stored_bytes = sizeof(root);
+    ex->frontier[0] = 0;
+    ex->frontier_count = 1;
+    chip8_hashset_insert(&ex->seen, chip8_hash(&root, sizeof(root)));
+    chip8_hashset_insert(&ex->frames, chip8_hash(root.video_buffer, sizeof(root.video_buffer)));
+    return EXIT_SUCCESS;
+}
+
+void chip8_explore_free(chip8_explore_p ex)
+{
+    for (uint32_t i = 0; i < ex->state_count; i++)
+        free(ex->states[i].data);
+    free(ex->states);
+    free(ex->frontier);
+    free(ex->seen.slots);
+    free(ex->frames.slots);
+}
+
+uint32_t chip8_explore_level(chip8_explore_p ex)
+{
+    static chip8_explore_worker_t workers[CHIP8E_EXPLORE_MAX_THREADS];
+    pthread_t tids[CHIP8E_EXPLORE_MAX_THREADS];
+    uint32_t found = 0;
+
+    if (0 == ex->frontier_count || ex->depth >= ex->max_depth)
+        return 0;
+
+    ex->cursor = 0;
+    for (int t = 0; t < ex->threads; t++) {
+        memset(&workers[t], 0x00, sizeof(workers[t]));
+        workers[t].ex = ex;
+        if (pthread_create(&tids[t], NULL, chip8_explore_worker, &workers[t])) {
+            // Run what could not be started on this thread
+            chip8_explore_worker(&workers[t]);
+            tids[t] = 0;
+        }
+    }
+    for (int t = 0; t < ex->threads; t++)
+        if (tids[t])
+            pthread_join(tids[t], NULL);
+
+    // Merge, the states are only read by workers of the next level
+    for (int t = 0; t < ex->threads; t++)
+        found += workers[t].count;
+    chip8_explore_state_t *states = realloc(ex->states,
+        (ex->state_count + found) * sizeof(*states));
+    uint32_t *frontier = realloc(ex->frontier, (found ? found : 1) * sizeof(*frontier));
+    if (NULL == states || NULL == frontier) {
+        printf("Out of memory.\n");
+        exit(EXIT_FAILURE);
+    }
+    ex->states = states;
+    ex->frontier = frontier;
+    ex->frontier_count = 0;
+    for (int t = 0; t < ex->threads; t++) {
+        chip8_explore_worker_t *w = &workers[t];
+        for (uint32_t i = 0; i < w->count; i++) {
+            ex->stored_bytes += w->found[i].size;
+            ex->frontier[ex->frontier_count++] = ex->state_count;
+            ex->states[ex->state_count++] = w->found[i];
+        }
+        for (int b = 0; b < CHIP8E_MEM_SIZE / 8; b++)
+            ex->coverage[b] |= w->coverage[b];
+        ex->forks += w->forks;
+        ex->exceptions += w->exceptions;
+        free(w->found);
+    }
+    ex->depth++;
+    return found;
+}
@@ -0,0 +1,98 @@
+#ifndef __EXPLORE_H
+#define __EXPLORE_H
+
+#include <pthread.h>
+
+#include "chip8.h"
+
+/**
+ * State space exploration.
+ *
+ * Starting from a loaded machine, every state is forked once per input
+ * (no key, or one of the 16 keys held) and each fork runs one 60 Hz frame
+ * on the VIP clock. States are deduplicated on a 64 bit hash of the whole
+ * machine image and new ones form the next frontier, breadth first. The
+ * frontier of a level is shared among threads through an atomic cursor;
+ * the hash sets are open addressing tables filled with compare and swap.
+ *
+ * A stored state is a delta against its parent: a bitmap of the
+ * CHIP8E_EXPLORE_BLOCK byte blocks of the image that differ and their
+ * contents. Every CHIP8E_EXPLORE_KEY_DEPTH levels a state is stored
+ * whole, which bounds the chain walked to rebuild one.
+ *
+ * The image leaves out what only grows (instruction and cycle counts) and
+ * keeps the phase of the 60 Hz clock, so two machines in the same image
+ * behave the same from then on. Hash collisions are ignored.
+ **/
+
+// Inputs tried from every state: no key, then keys 0..F
+#define CHIP8E_EXPLORE_INPUTS (1 + CHIP8E_KEY_COUNT)
+#define CHIP8E_EXPLORE_BLOCK 16
+#define CHIP8E_EXPLORE_KEY_DEPTH 16
+#define CHIP8E_EXPLORE_MAX_THREADS 64
+
+// What makes two machines the same, packed for hashing and deltas
+typedef struct {
+    uint8_t memory[CHIP8E_MEM_SIZE];
+    uint8_t video_buffer[CHIP8E_XRES * CHIP8E_YRES];
+    uint16_t stack[CHIP8E_STACK_SIZE];
+    uint8_t V[16];
+    uint16_t I, PC;
+    uint8_t SP, DT, ST, pad;
+    uint32_t seed;
+    // Cycles left to the next 60 Hz interrupt
+    uint32_t phase;
+} chip8_image_t;
+
+#define CHIP8E_EXPLORE_BLOCKS \
+    ((sizeof(chip8_image_t) + CHIP8E_EXPLORE_BLOCK - 1) / CHIP8E_EXPLORE_BLOCK)
+
+typedef struct {
+    uint32_t parent;
+    uint16_t depth;
+    uint8_t input;
+    // Delta against the parent, or the whole image at key depths
+    uint32_t size;
+    uint8_t *data;
+} chip8_explore_state_t;
+
+// Set of 64 bit hashes, 0 marks a free slot
+typedef struct {
+    uint64_t *slots;
+    uint64_t mask;
+    uint64_t count;
+} chip8_hashset_t;
+
+typedef struct {
+    int threads;
+    uint32_t max_states;
+    uint16_t max_depth;
+
+    chip8_explore_state_t *states;
+    uint32_t state_count;
+    uint32_t *frontier;
+    uint32_t frontier_count;
+    // Next frontier entry to take, shared by the workers
+    uint32_t cursor;
+
+    chip8_hashset_t seen;
+    chip8_hashset_t frames;
+    // PCs executed, one bit each
+    uint8_t coverage[CHIP8E_MEM_SIZE / 8];
+
+    uint16_t depth;
+    uint64_t forks;
+    uint64_t exceptions;
+    uint64_t stored_bytes;
+} chip8_explore_t, *chip8_explore_p;
+
+int chip8_explore_init(chip8_explore_p ex, chip8_p chip, int threads,
+    uint32_t max_states, uint16_t max_depth);
+void chip8_explore_free(chip8_explore_p ex);
+// Explore one more level, returns the number of new states
+uint32_t chip8_explore_level(chip8_explore_p ex);
+// Rebuild a stored state
+void chip8_explore_image(chip8_explore_p ex, uint32_t index, chip8_image_t *image);
+void chip8_explore_restore(const chip8_image_t *image, chip8_p chip);
+
+#endif // __EXPLORE_H
@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "chip8.h"
+#include "fuse.h"
+
+#define IS_LDI(c)  (CHIP8_INSTR_CMD(c) == 0xA)
+#define IS_DRW(c)  (CHIP8_INSTR_CMD(c) == 0xD)
+#define IS_JP(c)   (CHIP8_INSTR_CMD(c) == 0x1)
+#define IS_SE(c)   (CHIP8_INSTR_CMD(c) == 0x3)
+#define IS_SNE(c)  (CHIP8_INSTR_CMD(c) == 0x4)
+#define IS_ADD(c)  (CHIP8_INSTR_CMD(c) == 0x7)
+#define IS_LDDT(c) (CHIP8_INSTR_CMD(c) == 0xF && CHIP8_INSTR_BYTE(c) == 0x07)
+#define SAME_VX(a, b) (CHIP8_INSTR_R1(a) == CHIP8_INSTR_R1(b))
+
+void chip8_fusion_attach(chip8_p chip, chip8_fusion_p fusion)
+{
+    chip8_fusion_scan(fusion, chip->memory);
+    chip->fusion = fusion;
+}
+
+void chip8_fusion_detach(chip8_p chip)
+{
+    chip->fusion = NULL;
+}
+
+// Longest sequence starting with c0, c1, c2
+static chip8_fuse_kind_t chip8_fusion_match(uint16_t c0, uint16_t c1, uint16_t c2)
+{
+    if (IS_LDI(c0) && IS_DRW(c1))
+        return CHIP8E_FUSE_LDI_DRW;
+    if (IS_SE(c0) && IS_JP(c1))
+        return CHIP8E_FUSE_SE_JP;
+    if (IS_SNE(c0) && IS_JP(c1))
+        return CHIP8E_FUSE_SNE_JP;
+    if (IS_ADD(c0) && IS_SE(c1) && SAME_VX(c0, c1))
+        return IS_JP(c2) ? CHIP8E_FUSE_ADD_SE_JP : CHIP8E_FUSE_ADD_SE;
+    if (IS_LDDT(c0) && IS_SE(c1) && SAME_VX(c0, c1))
+        return IS_JP(c2) ? CHIP8E_FUSE_LDDT_SE_JP : CHIP8E_FUSE_LDDT_SE;
+    return CHIP8E_FUSE_NONE;
+}
+
+int chip8_fusion_scan(chip8_fusion_p fusion, const uint8_t *memory)
+{
+    int sites = 0;
+
+    memset(fusion->kind, CHIP8E_FUSE_NONE, sizeof(fusion->kind));
+    // Code may start at odd addresses too, tag both alignments.
+    // Sequences do not wrap around the end of memory.
+    for (int a = 0; a + CHIP8E_FUSE_MAX_LEN <= CHIP8E_MEM_SIZE; a++) {
+        uint16_t c0 = memory[a] << 8 | memory[a + 1];
+        uint16_t c1 = memory[a + 2] << 8 | memory[a + 3];
+        uint16_t c2 = memory[a + 4] << 8 | memory[a + 5];
+        fusion->kind[a] = chip8_fusion_match(c0, c1, c2);
+        if (fusion->kind[a] != CHIP8E_FUSE_NONE)
+            sites++;
+    }
+    return sites;
+}
+
+void chip8_fusion_invalidate(chip8_fusion_p fusion, uint16_t addr)
+{
+    for (int a = addr - (CHIP8E_FUSE_MAX_LEN - 1); a <= addr; a++)
+        if (a >= 0)
+            fusion->kind[a] = CHIP8E_FUSE_NONE;
+}
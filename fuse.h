@@ -0,0 +1,49 @@
+#ifndef __FUSE_H
+#define __FUSE_H
+
+#include "chip8.h"
+
+/**
+ * Superinstructions for common opcode sequences.
+ *
+ * The fusion pass tags every address where one of the sequences below
+ * starts. When PC reaches a tagged address chip8_cycle() runs the whole
+ * sequence through one handler instead of dispatching each instruction.
+ * A skip or jump into the middle of a sequence just lands on an address
+ * with its own tag, or none, so no special case is needed for it.
+ * Stores into memory drop the tags of sequences that cover the written
+ * byte; they fall back to the plain interpreter.
+ *
+ * Fused sequences do not stop for breakpoints, so fusion is bypassed
+ * while a debugger is attached.
+ **/
+
+typedef enum {
+    CHIP8E_FUSE_NONE,
+    CHIP8E_FUSE_LDI_DRW,      // LD I, nnn; DRW Vx, Vy, n
+    CHIP8E_FUSE_SE_JP,        // SE Vx, nn; JP nnn
+    CHIP8E_FUSE_SNE_JP,       // SNE Vx, nn; JP nnn
+    CHIP8E_FUSE_ADD_SE,       // ADD Vx, nn; SE Vx, nn
+    CHIP8E_FUSE_ADD_SE_JP,    // ADD Vx, nn; SE Vx, nn; JP nnn
+    CHIP8E_FUSE_LDDT_SE,      // LD Vx, DT; SE Vx, nn
+    CHIP8E_FUSE_LDDT_SE_JP,   // LD Vx, DT; SE Vx, nn; JP nnn
+    CHIP8E_FUSE_KINDS
+} chip8_fuse_kind_t;
+
+// Longest fused sequence in bytes
+#define CHIP8E_FUSE_MAX_LEN 6
+
+typedef struct chip8_fusion {
+    // Sequence starting at each address
+    uint8_t kind[CHIP8E_MEM_SIZE];
+} chip8_fusion_t, *chip8_fusion_p;
+
+// Scan the machine's memory and enable fused execution
+void chip8_fusion_attach(chip8_p chip, chip8_fusion_p fusion);
+void chip8_fusion_detach(chip8_p chip);
+// Tag every sequence in memory, returns the number of tagged addresses
+int chip8_fusion_scan(chip8_fusion_p fusion, const uint8_t *memory);
+// Drop the sequences covering a written address
+void chip8_fusion_invalidate(chip8_fusion_p fusion, uint16_t addr);
+
+#endif // __FUSE_H
@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "chip8.h"
+#include "display.h"
+#include "grid.h"
+
+// Columns that make the tiles largest in the output
+static int chip8_grid_columns(int count, int out_w, int out_h)
+{
+    int best = 1;
+    double best_scale = 0;
+    for (int cols = 1; cols <= count; cols++) {
+        int rows = (count + cols - 1) / cols;
+        double sx = (double)out_w / (cols * CHIP8E_GRID_TILE_W + CHIP8E_GRID_GAP);
+        double sy = (double)out_h / (rows * CHIP8E_GRID_TILE_H + CHIP8E_GRID_GAP);
+        double scale = (sx < sy) ? sx : sy;
+        if (scale > best_scale) {
+            best_scale = scale;
+            best = cols;
+        }
+    }
+    return best;
+}
+
+void chip8_grid_layout(chip8_grid_p grid, int count, int out_w, int out_h)
+{
+    int cols = chip8_grid_columns(count, out_w, out_h);
+    int rows = (count + cols - 1) / cols;
+
+    grid->count = count;
+    grid->cols = cols;
+    grid->w = cols * CHIP8E_GRID_TILE_W + CHIP8E_GRID_GAP;
+    grid->h = rows * CHIP8E_GRID_TILE_H + CHIP8E_GRID_GAP;
+    grid->out_w = out_w;
+    grid->out_h = out_h;
+
+    // Whole pixels when the output is large enough, centered
+    double scale = (double)out_w / grid->w;
+    if ((double)out_h / grid->h < scale)
+        scale = (double)out_h / grid->h;
+    if (scale >= 1)
+        scale = (int)scale;
+    grid->dst_w = grid->w * scale;
+    grid->dst_h = grid->h * scale;
+    grid->dst_x = (out_w - grid->dst_w) / 2;
+    grid->dst_y = (out_h - grid->dst_h) / 2;
+}
+
+int chip8_grid_tile_at(const chip8_grid_t *grid, int x, int y)
+{
+    if (grid->count <= 0 || grid->dst_w <= 0 || grid->dst_h <= 0
+        || x < grid->dst_x || y < grid->dst_y)
+        return -1;
+    int ax = (x - grid->dst_x) * grid->w / grid->dst_w;
+    int ay = (y - grid->dst_y) * grid->h / grid->dst_h;
+    if (ax >= grid->w || ay >= grid->h)
+        return -1;
+    // The gap left of and above a tile belongs to it
+    int col = (ax - CHIP8E_GRID_GAP) / CHIP8E_GRID_TILE_W;
+    int tile = (ay - CHIP8E_GRID_GAP) / CHIP8E_GRID_TILE_H * grid->cols + col;
+    if (col >= grid->cols || tile >= grid->count)
+        return -1;
+    return tile;
+}
+
+int chip8_grid_select(chip8_p chips, int count, int selected, int events, int picked)
+{
+    int next = selected;
+
+    if (events & CHIP8E_DISPLAY_PICK) {
+        if (picked >= 0 && picked < count)
+            next = picked;
+    } else if (events & CHIP8E_DISPLAY_NEXT) {
+        next = (selected + 1) % count;
+    }
+    if (next != selected)
+        chips[selected].keys = 0;
+    return next;
+}
@@ -0,0 +1,41 @@
+#ifndef __GRID_H
+#define __GRID_H
+
+#include "chip8.h"
+
+/**
+ * Layout of the multi machine grid (chip8e -g) and keypad routing.
+ *
+ * Machines are tiles of one atlas at one texel per pixel, separated and
+ * framed by a CHIP8E_GRID_GAP texel gap. chip8_grid_layout() picks the
+ * column count that makes the tiles largest in the output and places the
+ * atlas centered, scaled by whole pixels when it fits. Coordinates are
+ * output pixels; backends convert window coordinates first.
+ *
+ * No display code here, so the geometry and the routing are covered by
+ * `make check`.
+ **/
+
+#define CHIP8E_GRID_GAP 1
+#define CHIP8E_GRID_TILE_W (CHIP8E_XRES + CHIP8E_GRID_GAP)
+#define CHIP8E_GRID_TILE_H (CHIP8E_YRES + CHIP8E_GRID_GAP)
+
+typedef struct {
+    int count, cols;
+    // Atlas size in texels
+    int w, h;
+    // Output it was laid out for, and where the atlas goes in it
+    int out_w, out_h;
+    int dst_x, dst_y, dst_w, dst_h;
+} chip8_grid_t, *chip8_grid_p;
+
+// Lay count tiles out for an output of out_w x out_h pixels
+void chip8_grid_layout(chip8_grid_p grid, int count, int out_w, int out_h);
+// Tile under an output pixel, -1 for none
+int chip8_grid_tile_at(const chip8_grid_t *grid, int x, int y);
+// Apply CHIP8E_DISPLAY_PICK / NEXT events to the selected machine and
+// return the new one. picked is the clicked tile, a pick outside the grid
+// is ignored. Keys held on a machine that loses the keypad are released.
+int chip8_grid_select(chip8_p chips, int count, int selected, int events, int picked);
+
+#endif // __GRID_H
@@ -2,6 +2,8 @@
 #define __INSTRUCTIONS_H
 
 #include "chip8.h"
+#include "debug.h"
+#include "fuse.h"
 #include <stdlib.h>
 
 /**
@@ -16,10 +18,30 @@
  * nnn - 12-bit value
  **/
 
+// Data reads and writes, checked against watchpoints when debugging
+static inline uint8_t mem_read(chip8_p chip, uint16_t addr)
+{
+    addr = CHIP8E_MEM_MASK(addr);
+    if (chip->debug)
+        chip8_debug_read(chip, addr);
+    return chip->memory[addr];
+}
+
+static inline void mem_write(chip8_p chip, uint16_t addr, uint8_t b)
+{
+    addr = CHIP8E_MEM_MASK(addr);
+    if (chip->debug)
+        chip8_debug_write(chip, addr);
+    if (chip->fusion)
+        chip8_fusion_invalidate(chip->fusion, addr);
+    chip->dirty_pages |= 1 << (addr >> CHIP8E_PAGE_SHIFT);
+    chip->memory[addr] = b;
+}
+
 // Jump to a machine code routine at nnn.
  void i_sys(chip8_p chip, uint16_t addr)
 {
-    printf("System call requested to %04X.\n", CHIP8E_MEM_MASK(addr));
+    CHIP8E_TRACE("System call requested to %04X.\n", CHIP8E_MEM_MASK(addr));
     chip->PC += 2;
     // unimplemented
 }
@@ -27,7 +49,7 @@
 // Clear the display.
  void i_cls(chip8_p chip)
 {
-    printf("%04X: CLS\n", chip->PC);
+    CHIP8E_TRACE("%04X: CLS\n", chip->PC);
     for (int i = 0; i < (CHIP8E_XRES * CHIP8E_YRES); i++) {
         chip->video_buffer[i] = 0x0;
     }
@@ -39,30 +61,30 @@
 // Return from a subroutine.
  void i_ret(chip8_p chip)
 {
-    printf("%04X: RET \n", chip->PC);
-    chip8_stack_pop(chip, &(chip->PC));
-    chip->PC += 2;
+    CHIP8E_TRACE("%04X: RET \n", chip->PC);
+    if (EXIT_SUCCESS == chip8_stack_pop(chip, &(chip->PC)))
+        chip->PC += 2;
 }
 
 // Sets the program counter to nnn.
  void i_jp(chip8_p chip, uint16_t addr)
 {
-    printf("%04X: JP   %04x\n", chip->PC, addr);
+    CHIP8E_TRACE("%04X: JP   %04x\n", chip->PC, addr);
     chip->PC = CHIP8E_MEM_MASK(addr);
 }
 
 // Call subroutine at nnn.
  void i_call(chip8_p chip, uint16_t addr)
 {
-    printf("%04X: CALL %04x\n", chip->PC, addr);
-    chip8_stack_push(chip, chip->PC);
-    chip->PC = CHIP8E_MEM_MASK(addr);
+    CHIP8E_TRACE("%04X: CALL %04x\n", chip->PC, addr);
+    if (EXIT_SUCCESS == chip8_stack_push(chip, chip->PC))
+        chip->PC = CHIP8E_MEM_MASK(addr);
 }
 
 // Skip next instruction if Vx = nn.
  void i_sevxb(chip8_p chip, uint8_t reg, uint8_t b)
 {
-    printf("%04X: SE   V%02X %02x\n", chip->PC, reg, b);
+    CHIP8E_TRACE("%04X: SE   V%02X %02x\n", chip->PC, reg, b);
 
     if (chip->V[CHIP8E_REG_MASK(reg)] == b)
         chip->PC += 4;
@@ -73,7 +95,7 @@
 // Skip next instruction if Vx != nn.
  void i_snevxb(chip8_p chip, uint8_t reg, uint8_t b)
 {
-    printf("%04X: SNE  V%02X %02x\n", chip->PC, reg, b);
+    CHIP8E_TRACE("%04X: SNE  V%02X %02x\n", chip->PC, reg, b);
     if (chip->V[CHIP8E_REG_MASK(reg)] != b)
         chip->PC += 4;
     else
@@ -83,7 +105,7 @@
 // Skip next instruction if Vx = Vy.
  void i_sevxvy(chip8_p chip, uint8_t regx, uint8_t regy)
 {
-    printf("%04X: SE   V%02X V%02X\n", chip->PC, regx, regy);
+    CHIP8E_TRACE("%04X: SE   V%02X V%02X\n", chip->PC, regx, regy);
 
     if (chip->V[CHIP8E_REG_MASK(regx)] == chip->V[CHIP8E_REG_MASK(regy)])
         chip->PC += 4;
@@ -94,7 +116,7 @@
 // puts the value kk into register Vx
  void i_ldvxb(chip8_p chip, uint8_t reg, uint8_t b)
 {
-    printf("%04X: LD   V%02X %02x\n", chip->PC, reg, b);
+    CHIP8E_TRACE("%04X: LD   V%02X %02x\n", chip->PC, reg, b);
     chip->V[CHIP8E_REG_MASK(reg)] = b;
     chip->PC += 2;
 }
@@ -102,7 +124,7 @@
 // adds the value kk to register Vx
  void i_addvxb(chip8_p chip, uint8_t reg, uint8_t b)
 {
-    printf("%04X: ADD  V%02X %02x\n", chip->PC, reg, b);
+    CHIP8E_TRACE("%04X: ADD  V%02X %02x\n", chip->PC, reg, b);
     chip->V[CHIP8E_REG_MASK(reg)] += b;
     chip->PC += 2;
 }
@@ -110,7 +132,7 @@
 // load register Vy to register Vx
  void i_ldvxvy(chip8_p chip, uint8_t regx, uint8_t regy)
 {
-    printf("%04X: LD   V%02X V%02X\n", chip->PC, regx, regy);
+    CHIP8E_TRACE("%04X: LD   V%02X V%02X\n", chip->PC, regx, regy);
     chip->V[CHIP8E_REG_MASK(regx)] = chip->V[CHIP8E_REG_MASK(regy)];
     chip->PC += 2;
 }
@@ -118,7 +140,7 @@
 // bitwise or register Vy and register Vx
  void i_orvxvy(chip8_p chip, uint8_t regx, uint8_t regy)
 {
-    printf("%04X: OR   V%02X V%02X\n", chip->PC, regx, regy);
+    CHIP8E_TRACE("%04X: OR   V%02X V%02X\n", chip->PC, regx, regy);
     chip->V[CHIP8E_REG_MASK(regx)] |= chip->V[CHIP8E_REG_MASK(regy)];
     chip->PC += 2;
 }
@@ -126,7 +148,7 @@
 // bitwise and register Vy and register Vx
  void i_andvxvy(chip8_p chip, uint8_t regx, uint8_t regy)
 {
-    printf("%04X: AND  V%02X V%02X\n", chip->PC, regx, regy);
+    CHIP8E_TRACE("%04X: AND  V%02X V%02X\n", chip->PC, regx, regy);
     chip->V[CHIP8E_REG_MASK(regx)] &= chip->V[CHIP8E_REG_MASK(regy)];
     chip->PC += 2;
 }
@@ -134,7 +156,7 @@
 // bitwise xor register Vy and register Vx
  void i_xorvxvy(chip8_p chip, uint8_t regx, uint8_t regy)
 {
-    printf("%04X: XOR  V%02X V%02X\n", chip->PC, regx, regy);
+    CHIP8E_TRACE("%04X: XOR  V%02X V%02X\n", chip->PC, regx, regy);
     chip->V[CHIP8E_REG_MASK(regx)] ^= chip->V[CHIP8E_REG_MASK(regy)];
     chip->PC += 2;
 }
@@ -142,7 +164,7 @@
 // add register Vy and register Vx and store result in Vx, set VF = carry
  void i_addvxvy(chip8_p chip, uint8_t regx, uint8_t regy)
 {
-    printf("%04X: ADD  V%02X V%02X\n", chip->PC, regx, regy);
+    CHIP8E_TRACE("%04X: ADD  V%02X V%02X\n", chip->PC, regx, regy);
     chip->V[VF] = (chip->V[CHIP8E_REG_MASK(regx)] + chip->V[CHIP8E_REG_MASK(regy)] > 0xFF) ? 1 : 0;
     chip->V[CHIP8E_REG_MASK(regx)] += chip->V[CHIP8E_REG_MASK(regy)];
     chip->PC += 2;
@@ -151,7 +173,7 @@
 // substract register Vy from register Vx and store result in Vx, set VF = borrow
  void i_subvxvy(chip8_p chip, uint8_t regx, uint8_t regy)
 {
-    printf("%04X: SUB  V%02X V%02X\n", chip->PC, regx, regy);
+    CHIP8E_TRACE("%04X: SUB  V%02X V%02X\n", chip->PC, regx, regy);
     chip->V[VF] = (chip->V[CHIP8E_REG_MASK(regx)] > chip->V[CHIP8E_REG_MASK(regy)]) ? 1 : 0;
     chip->V[CHIP8E_REG_MASK(regx)] -= chip->V[CHIP8E_REG_MASK(regy)];
     chip->PC += 2;
@@ -160,7 +182,7 @@
 // If the least-significant bit of Vx is 1, then VF is set to 1, otherwise 0. Then Vx is divided by 2.
  void i_shrvx(chip8_p chip, uint8_t regx)
 {
-    printf("%04X: SHR  V%02X\n", chip->PC, regx);
+    CHIP8E_TRACE("%04X: SHR  V%02X\n", chip->PC, regx);
     // LSB -> endianness!
     chip->V[VF] = (chip->V[CHIP8E_REG_MASK(regx)] & CHIP8_ENDIAN_MASK_LSB);
     chip->V[CHIP8E_REG_MASK(regx)] >>= 1;
@@ -170,7 +192,7 @@
 // substract register Vy from register Vx and store result in Vx, set VF = borrow
  void i_subnvxvy(chip8_p chip, uint8_t regx, uint8_t regy)
 {
-    printf("%04X: SUBN V%02X V%02X\n", chip->PC, regx, regy);
+    CHIP8E_TRACE("%04X: SUBN V%02X V%02X\n", chip->PC, regx, regy);
     chip->V[VF] = (chip->V[CHIP8E_REG_MASK(regy)] > chip->V[CHIP8E_REG_MASK(regx)]) ? 1 : 0;
     chip->V[CHIP8E_REG_MASK(regx)] = chip->V[CHIP8E_REG_MASK(regy)] - chip->V[CHIP8E_REG_MASK(regx)];
     chip->PC += 2;
@@ -179,7 +201,7 @@
 // If the least-significant bit of Vx is 1, then VF is set to 1, otherwise 0. Then Vx is divided by 2.
  void i_shlvx(chip8_p chip, uint8_t regx)
 {
-    printf("%04X: SHL  V%02X\n", chip->PC, regx);
+    CHIP8E_TRACE("%04X: SHL  V%02X\n", chip->PC, regx);
     // LSB -> endianness!
     chip->V[VF] = (chip->V[CHIP8E_REG_MASK(regx)] & CHIP8_ENDIAN_MASK_MSB);
     chip->V[CHIP8E_REG_MASK(regx)] <<= 1;
@@ -189,7 +211,7 @@
 // Skip next instruction if Vx != Vy.
  void i_snevxvy(chip8_p chip, uint8_t regx, uint8_t regy)
 {
-    printf("%04X: SNE  V%02X V%02X\n", chip->PC, regx, regy);
+    CHIP8E_TRACE("%04X: SNE  V%02X V%02X\n", chip->PC, regx, regy);
     if (chip->V[CHIP8E_REG_MASK(regx)] != chip->V[CHIP8E_REG_MASK(regy)])
         chip->PC += 4;
         else
@@ -199,7 +221,7 @@
 // load w to register I.
  void i_ldiw(chip8_p chip, uint16_t w)
 {
-    printf("%04X: LDI  %04x\n", chip->PC, w);
+    CHIP8E_TRACE("%04X: LDI  %04x\n", chip->PC, w);
     chip->I = CHIP8E_MEM_MASK(w);
     chip->PC += 2;
 }
@@ -207,15 +229,15 @@
 //  Jump to location nnn + V0 (base relative)
  void i_jpv0w(chip8_p chip, uint16_t addr)
 {
-    printf("%04X: JP   V0 %04x\n", chip->PC, addr);
-    chip->PC = chip->V[V0] + CHIP8E_MEM_MASK(addr);
+    CHIP8E_TRACE("%04X: JP   V0 %04x\n", chip->PC, addr);
+    chip->PC = CHIP8E_MEM_MASK(chip->V[V0] + addr);
 }
 
 //  Set Vx = random byte AND kk.
  void i_rndvxb(chip8_p chip, uint8_t regx, uint8_t b)
 {
-    printf("%04X: RND  V%02X %02x\n", chip->PC, regx, b);
-    chip->V[CHIP8E_REG_MASK(regx)] = (rand() % 0xFF) & b;
+    CHIP8E_TRACE("%04X: RND  V%02X %02x\n", chip->PC, regx, b);
+    chip->V[CHIP8E_REG_MASK(regx)] = (rand_r(&chip->seed) % 0xFF) & b;
     chip->PC += 2;
 }
 
@@ -224,10 +246,22 @@
 {
     // Display API dependent
     // I points to memory location
-    printf("%04X: DRW  V%02X V%02X %02x\n", chip->PC, regx, regy, b);
-    //printf("Draw Sprite requested: I:%04X X:%02X Y:%02X bytes:%0X.\n",
-      //  chip->I, chip->V[CHIP8E_REG_MASK(regx)], chip->V[CHIP8E_REG_MASK(regy)], b);
-    // TODO
+    CHIP8E_TRACE("%04X: DRW  V%02X V%02X %02x\n", chip->PC, regx, regy, b);
+    CHIP8E_PROBE(drw, chip->PC, chip->opcode, chip->cycles);
+    uint8_t x = chip->V[CHIP8E_REG_MASK(regx)];
+    uint8_t y = chip->V[CHIP8E_REG_MASK(regy)];
+    chip->V[VF] = 0;
+    for (int row = 0; row < CHIP8E_REG_MASK(b); row++) {
+        uint8_t bits = mem_read(chip, chip->I + row);
+        uint8_t *line = chip->video_buffer + ((y + row) % CHIP8E_YRES) * CHIP8E_XRES;
+        for (int col = 0; col < 8; col++) {
+            uint8_t pixel = (bits >> (7 - col)) & 0x01;
+            uint8_t *p = line + (x + col) % CHIP8E_XRES;
+            if (pixel & *p)
+                chip->V[VF] = 1;
+            *p ^= pixel;
+        }
+    }
     chip->video_dirty = true;
     chip->PC += 2;
 }
@@ -235,27 +269,27 @@
 //  Skip next instruction if key with the value of Vx is pressed.
  void i_skpvx(chip8_p chip, uint8_t regx)
 {
-    printf("%04X: SKP  V%02X\n", chip->PC, regx);
-    // Input API dependent
-    //printf("Skip on keydown requested: VX:%02X.\n", chip->V[CHIP8E_REG_MASK(regx)]);
-    // TODO
-    chip->PC += 2;
+    CHIP8E_TRACE("%04X: SKP  V%02X\n", chip->PC, regx);
+    if (chip->keys & CHIP8E_KEY_BIT(chip->V[CHIP8E_REG_MASK(regx)]))
+        chip->PC += 4;
+    else
+        chip->PC += 2;
 }
 
 //  Skip next instruction if key with the value of Vx is not pressed.
  void i_sknpvx(chip8_p chip, uint8_t regx)
 {
-    printf("%04X: SKNP V%02X\n", chip->PC, regx);
-    // Input API dependent
-    //printf("Skip on keyup requested: VX:%02X.\n", chip->V[CHIP8E_REG_MASK(regx)]);
-    // TODO
-    chip->PC += 2;
+    CHIP8E_TRACE("%04X: SKNP V%02X\n", chip->PC, regx);
+    if (chip->keys & CHIP8E_KEY_BIT(chip->V[CHIP8E_REG_MASK(regx)]))
+        chip->PC += 2;
+    else
+        chip->PC += 4;
 }
 
 //  Set Vx = delay timer value.
  void i_ldvxdt(chip8_p chip, uint8_t regx)
 {
-    printf("%04X: LD   V%02X DT\n", chip->PC, regx);
+    CHIP8E_TRACE("%04X: LD   V%02X DT\n", chip->PC, regx);
     chip->V[CHIP8E_REG_MASK(regx)] = chip->DT;
     chip->PC += 2;
 }
@@ -263,7 +297,7 @@
 //  Set DT = Vx.
  void i_lddtvx(chip8_p chip, uint8_t regx)
 {
-    printf("%04X: LD   DT V%02X\n", chip->PC, regx);
+    CHIP8E_TRACE("%04X: LD   DT V%02X\n", chip->PC, regx);
     chip->DT = chip->V[CHIP8E_REG_MASK(regx)];
     chip->PC += 2;
 }
@@ -271,7 +305,7 @@
 //  Set ST = Vx.
  void i_ldstvx(chip8_p chip, uint8_t regx)
 {
-    printf("%04X: LD   ST V%02X\n", chip->PC, regx);
+    CHIP8E_TRACE("%04X: LD   ST V%02X\n", chip->PC, regx);
     // Sound API dependent
     chip->ST = chip->V[CHIP8E_REG_MASK(regx)];
     chip->PC += 2;
@@ -280,19 +314,22 @@
 //  Wait for a key press, store the value of the key in Vx.
  void i_ldvxk(chip8_p chip, uint8_t regx)
 {
-    printf("%04X: LD   V%02X K\n", chip->PC, regx);
-    // Input API dependent
-    // TODO
-    chip->V[CHIP8E_REG_MASK(regx)] = 0xFF;
-    chip->PC += 2;
-    //printf("Readkey requested: VX:%02X.\n", chip->V[CHIP8E_REG_MASK(regx)]);
+    CHIP8E_TRACE("%04X: LD   V%02X K\n", chip->PC, regx);
+    // No key down: leave PC alone, the instruction runs again next cycle
+    for (int k = 0; k < CHIP8E_KEY_COUNT; k++) {
+        if (chip->keys & CHIP8E_KEY_BIT(k)) {
+            chip->V[CHIP8E_REG_MASK(regx)] = k;
+            chip->PC += 2;
+            break;
+        }
+    }
 }
 
 // The values of I and Vx are added, and the results are stored in I.
  void i_addivx(chip8_p chip, uint8_t regx)
 {
-    printf("%04X: ADD  I V%02X\n", chip->PC, regx);
-    chip->I += chip->V[CHIP8E_REG_MASK(regx)];
+    CHIP8E_TRACE("%04X: ADD  I V%02X\n", chip->PC, regx);
+    chip->I = CHIP8E_MEM_MASK(chip->I + chip->V[CHIP8E_REG_MASK(regx)]);
     chip->PC += 2;
 }
 
@@ -300,35 +337,37 @@
 // Register I points in memory to sprite representing value of VX as digit.
  void i_ldfvx(chip8_p chip, uint8_t regx)
 {
-    printf("%04X: LD   F V%02X\n", chip->PC, regx);
+    CHIP8E_TRACE("%04X: LD   F V%02X\n", chip->PC, regx);
     // determine sprite address for sprite
-    chip->I = CHIP8E_MEM_OFFSET_SPRITE_START + chip->V[CHIP8E_REG_MASK(regx)] * 5;
+    chip->I = CHIP8E_MEM_OFFSET_SPRITE_START + CHIP8E_REG_MASK(chip->V[CHIP8E_REG_MASK(regx)]) * 5;
     chip->PC += 2;
 }
 
 // Store BCD representation of Vx in memory locations I, I+1, and I+2.
  void i_ldbvx(chip8_p chip, uint8_t regx) {
-     printf("%04X: LD   B V%02X\n", chip->PC, regx);
+     CHIP8E_TRACE("%04X: LD   B V%02X\n", chip->PC, regx);
     uint8_t n = chip->V[CHIP8E_REG_MASK(regx)];
-    chip->memory[chip->I] = n / 100;
-    chip->memory[chip->I + 1] = (n % 100) / 10;
-    chip->memory[chip->I + 2] = (n % 100) % 10;
+    mem_write(chip, chip->I, n / 100);
+    mem_write(chip, chip->I + 1, (n % 100) / 10);
+    mem_write(chip, chip->I + 2, (n % 100) % 10);
     chip->PC += 2;
 }
 
 // Store registers V0 through Vx in memory starting at location I.
 void i_ldivx(chip8_p chip, uint8_t regx) {
-    printf("%04X: LD   [I] V%02X\n", chip->PC, regx);
-    for (int i = 0; i < CHIP8E_REG_MASK(regx); i++)
-        chip->memory[chip->I + i] = chip->V[i];
+    CHIP8E_TRACE("%04X: LD   [I] V%02X\n", chip->PC, regx);
+    // Vx included, Fx55 with x = 0 stores V0
+    for (int i = 0; i <= CHIP8E_REG_MASK(regx); i++)
+        mem_write(chip, chip->I + i, chip->V[i]);
     chip->PC += 2;
 }
 
 //  Read registers V0 through Vx from memory starting at location I.
 void i_ldvxi(chip8_p chip, uint8_t regx) {
-    printf("%04X: LD   V%02X [I]\n", chip->PC, regx);
-    for (int i = 0; i < CHIP8E_REG_MASK(regx); i++)
-        chip->V[i] = chip->memory[chip->I + i];
+    CHIP8E_TRACE("%04X: LD   V%02X [I]\n", chip->PC, regx);
+    // Vx included, as for Fx55
+    for (int i = 0; i <= CHIP8E_REG_MASK(regx); i++)
+        chip->V[i] = mem_read(chip, chip->I + i);
     chip->PC += 2;
 }
 
@@ -6,48 +6,263 @@
 #include <unistd.h>
 #include <errno.h>
 
-#include <SDL.h>
-
 #include "chip8.h"
 #include "sprites.h"
 #include "stack.h"
+#include "debug.h"
+#include "fuse.h"
+#include "timing.h"
+#include "stream.h"
+#include "display.h"
+#include "stats.h"
+#include "watchdog.h"
+#include "grid.h"
+#include "probes.h"
 
-void redraw(SDL_Renderer *renderer, uint8_t *video_buffer) {
-    SDL_Rect rect = {
-    .x = 0,
-    .y = 0,
-    .w = 8,
-    .h = 8
-    };
-
-    for (int i = 0; i < CHIP8E_XRES; i++)
-        for (int j = 0; j < CHIP8E_YRES; j++) {
-        if (0x01 == video_buffer[i * CHIP8E_XRES + j]) {
-            SDL_SetRenderDrawColor(renderer, 0x40, 0x40, 0x40, 0xFF);
-        } else {
-            SDL_SetRenderDrawColor(renderer, 0x80, 0x80, 0x80, 0xFF);
-        }
-        rect.x = i * (rect.w + 2);
-        rect.y = j * (rect.h + 2);
-        SDL_RenderFillRect(renderer, &rect);
-    }
-    SDL_RenderPresent(renderer);
-}
+// Exit status of a watched run that hung, trapped runs exit with EXIT_FAILURE
+#define CHIP8E_STATUS_HUNG 2
+
+#define CHIP8E_GRID_MAX 1024
 
 void usage()
 {
     // TODO
-    printf("Usage: chip8e -p progname -n\n");
+    printf("Usage: chip8e -p progname -n -d -f -r display -s filter -t model -i ips -H frames -S socket -T -W -B budget -g count [rom...]\n");
     printf("Options:\n"
-    "\t-p file - specifies the binary to be loaded.\n"
-    "\t-n      - disables sound.\n"
-    "\t-h      - this help.\n");
+    "\t-p file   - specifies the binary to be loaded.\n"
+    "\t-n        - disables sound.\n"
+    "\t-d        - starts in the debugger console, F1 breaks into it.\n"
+    "\t-f        - fuses common instruction sequences.\n"
+    "\t-r name   - display, sdl (default) or term for ANSI terminals.\n"
+    "\t-s filter - upscaling of the sdl display: nearest (default), scale2x,\n"
+    "\t            scale3x, scanline or grid.\n"
+    "\t-t model  - timing model, vip (default) or fixed.\n"
+    "\t-i ips    - instructions per second of the fixed model, implies -t fixed.\n"
+    "\t-H frames - runs that many frames without a window as fast as possible\n"
+    "\t            and reports emulated and host time.\n"
+    "\t-S path   - streams frames to chip8e-view clients on a Unix socket,\n"
+    "\t            with -H runs in real time.\n"
+    "\t-T        - publishes live statistics for chip8e-top.\n"
+    "\t-W        - stops when the program halts, hangs or traps and exits\n"
+    "\t            with 0, 2 and 1 respectively, for unattended runs.\n"
+    "\t-B count  - stops after count instructions, implies -W.\n"
+    "\t-g count  - runs count machines in one window, loaded in turn with\n"
+    "\t            the -p binary and any further ones given; click a tile\n"
+    "\t            or press Tab to route the keypad to it.\n"
+    "\t-h        - this help.\n");
+}
+
+// Run one 60 Hz frame of emulated time, or until the machine stops
+static void run_frame(chip8_p chip)
+{
+    // Without a clock frames never advance: run a fixed slice and tick
+    // the timers here, timing.h leaves them to the host
+    if (chip->timing == CHIP8E_TIMING_NONE) {
+        for (int i = 0; i < CHIP8E_FIXED_IPS_DEFAULT / CHIP8E_FRAME_HZ
+            && chip->state == CHIP_STATE_NORMAL; i++)
+            chip8_cycle(chip);
+        if (chip->DT > 0)
+            chip->DT--;
+        if (chip->ST > 0)
+            chip->ST--;
+        chip->frames++;
+        return;
+    }
+
+    uint64_t frame = chip->frames;
+    while (chip->state == CHIP_STATE_NORMAL && chip->frames == frame)
+        chip8_cycle(chip);
+}
+
+static int64_t timespec_diff(const struct timespec *a, const struct timespec *b)
+{
+    return (int64_t)(a->tv_sec - b->tv_sec) * 1000000000LL + (a->tv_nsec - b->tv_nsec);
+}
+
+// Sleep until the absolute deadline, then move it one frame on.
+// A deadline that has long passed (debugger, suspended process) is reset
+// instead of running the missed frames back to back.
+// Returns how late the sleep woke up in ns, -1 if the frame was already
+// late and there was nothing to sleep. chip only feeds the probes.
+static int64_t pace_frame(chip8_p chip, struct timespec *deadline)
+{
+    struct timespec now;
+    deadline->tv_nsec += 1000000000L / CHIP8E_FRAME_HZ;
+    if (deadline->tv_nsec >= 1000000000L) {
+        deadline->tv_nsec -= 1000000000L;
+        deadline->tv_sec++;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    CHIP8E_PROBE(pace_start, chip->PC, chip->opcode, chip->cycles,
+        timespec_diff(deadline, &now));
+    if (now.tv_sec > deadline->tv_sec + 1) {
+        *deadline = now;
+        CHIP8E_PROBE(pace_done, chip->PC, chip->opcode, chip->cycles, -1);
+        return -1;
+    }
+    if (timespec_diff(&now, deadline) > 0) {
+        CHIP8E_PROBE(pace_done, chip->PC, chip->opcode, chip->cycles, -1);
+        return -1;
+    }
+    while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, deadline, NULL))
+        ;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    CHIP8E_PROBE(pace_done, chip->PC, chip->opcode, chip->cycles,
+        timespec_diff(&now, deadline));
+    return timespec_diff(&now, deadline);
+}
+
+// Streaming runs in real time so viewers can follow
+static int run_headless(chip8_p chip, uint64_t frames, chip8_stream_p stream,
+    chip8_stats_p stats)
+{
+    struct timespec start, end, deadline;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    deadline = start;
+    uint64_t last = stats ? chip8_stats_now() : 0;
+    while (chip->state == CHIP_STATE_NORMAL && chip->frames < frames) {
+        int64_t overshoot = CHIP8E_STATS_UNPACED;
+        if (stream)
+            chip8_stream_poll(stream, chip);
+        run_frame(chip);
+        if (stream) {
+            chip8_stream_publish(stream, chip);
+            overshoot = pace_frame(chip, &deadline);
+        }
+        if (stats) {
+            uint64_t now = chip8_stats_now();
+            chip8_stats_frame(stats, chip, now - last, 0, overshoot);
+            last = now;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (chip->watchdog && chip->state == CHIP_STATE_NORMAL)
+        chip8_watchdog_stop(chip, CHIP8E_EXIT_BUDGET);
+
+    double host = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    double emulated = chip8_timing_seconds(chip);
+    printf("%llu instructions, %llu frames, %llu cycles\n",
+        (unsigned long long)chip->instructions,
+        (unsigned long long)chip->frames,
+        (unsigned long long)chip->cycles);
+    printf("Emulated %.3f s in %.3f s host time (%.1fx), %.0f instructions/s emulated\n",
+        emulated, host, (host > 0) ? emulated / host : 0.0,
+        (emulated > 0) ? chip->instructions / emulated : 0.0);
+
+    if (stream)
+        printf("%llu slow viewers dropped\n", (unsigned long long)stream->dropped);
+
+    if (chip->state == CHIP_STATE_EXCEPTION) {
+        chip8_trap(chip);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+// Classify how a watched run ended, returns the exit status
+static int report_exit(chip8_p chip)
+{
+    chip8_exit_reason_t reason = chip8_watchdog_reason(chip);
+    printf("Stopped: %s at PC %04X, opcode %04X, after %llu instructions",
+        chip8_exit_name(reason), CHIP8E_MEM_MASK(chip->PC), chip->opcode,
+        (unsigned long long)chip->instructions);
+    if (reason == CHIP8E_EXIT_HUNG)
+        printf(", state repeats every %llu checks",
+            (unsigned long long)chip->watchdog->period);
+    printf("\n");
+
+    if (reason == CHIP8E_EXIT_TRAPPED)
+        return EXIT_FAILURE;
+    if (reason == CHIP8E_EXIT_HUNG)
+        return CHIP8E_STATUS_HUNG;
+    return EXIT_SUCCESS;
+}
+
+// Grid of machines in one window, the keypad goes to the selected tile
+static int run_grid(char **binaries, int binary_count, int count, bool fuse_flag,
+    chip8_timing_t timing, uint32_t ips, const chip8_display_t *display)
+{
+    static uint8_t file_buf[CHIP8E_GRID_MAX][CHIP8E_MEM_SIZE];
+    static uint16_t size[CHIP8E_GRID_MAX];
+    chip8_p chips = calloc(count, sizeof(chip8_t));
+    chip8_fusion_p fusion = fuse_flag ? calloc(count, sizeof(chip8_fusion_t)) : NULL;
+    const uint8_t **buffers = calloc(count, sizeof(*buffers));
+    bool *dirty = calloc(count, sizeof(bool));
+    if (NULL == chips || (fuse_flag && NULL == fusion) || NULL == buffers || NULL == dirty) {
+        printf("Out of memory.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int b = 0; b < binary_count; b++) {
+        if (EXIT_SUCCESS != chip8_file_to_block(&chips[0], binaries[b], file_buf[b], &size[b])) {
+            printf("Error loading test file %s.\n", binaries[b]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        chip8_init(&chips[i]);
+        chip8_timing_init(&chips[i], timing, ips);
+        // Copies of one program should not draw the same random numbers
+        chips[i].seed += i;
+        chip8_block_to_mem(&chips[i], CHIP8E_MEM_OFFSET_PROGRAM_START,
+            file_buf[i % binary_count], size[i % binary_count]);
+        if (fuse_flag)
+            chip8_fusion_attach(&chips[i], &fusion[i]);
+        buffers[i] = chips[i].video_buffer;
+    }
+
+    if (EXIT_SUCCESS != display->open())
+        exit(EXIT_FAILURE);
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    int selected = 0;
+    for (;;) {
+        int events = display->input(&chips[selected].keys);
+        if (events & CHIP8E_DISPLAY_QUIT)
+            break;
+        if (events & (CHIP8E_DISPLAY_PICK | CHIP8E_DISPLAY_NEXT))
+            selected = chip8_grid_select(chips, count, selected, events,
+                (events & CHIP8E_DISPLAY_PICK) ? display->picked() : -1);
+
+        for (int i = 0; i < count; i++) {
+            run_frame(&chips[i]);
+            dirty[i] = chips[i].video_dirty;
+            chips[i].video_dirty = false;
+        }
+        CHIP8E_PROBE(present_start, chips[selected].PC, chips[selected].opcode,
+            chips[selected].cycles, chips[selected].frames);
+        display->present_grid(buffers, dirty, count, selected);
+        CHIP8E_PROBE(present_done, chips[selected].PC, chips[selected].opcode,
+            chips[selected].cycles, chips[selected].frames);
+        pace_frame(&chips[selected], &deadline);
+    }
+    display->close();
+
+    for (int i = 0; i < count; i++)
+        if (chips[i].state == CHIP_STATE_EXCEPTION)
+            printf("Machine %d (%s) trapped at PC %04X, opcode %04X.\n", i,
+                binaries[i % binary_count], chips[i].PC, chips[i].opcode);
+    free(dirty);
+    free(buffers);
+    free(fusion);
+    free(chips);
+    return EXIT_SUCCESS;
 }
 
-int execute_binary(char *binary, bool sound_flag)
+int execute_binary(char *binary, bool sound_flag, bool debug_flag, bool fuse_flag,
+    chip8_timing_t timing, uint32_t ips, uint64_t headless_frames, char *stream_path,
+    const chip8_display_t *display, bool stats_flag, bool watch_flag, uint64_t budget)
 {
     chip8_t chip;
+    chip8_debug_t dbg;
+    chip8_watchdog_t wd;
+    static chip8_fusion_t fusion;
+    static chip8_stream_t stream;
+    chip8_stream_p streamp = NULL;
+    chip8_stats_p stats = NULL;
     chip8_init(&chip);
+    chip8_timing_init(&chip, timing, ips);
 
     // Load program code to emulator memory
     uint8_t file_buf[CHIP8E_MEM_SIZE + 1];
@@ -59,84 +274,121 @@ int execute_binary(char *binary, bool sound_flag)
         exit(EXIT_FAILURE);
     }
 
-  if (SDL_Init(SDL_INIT_VIDEO) != 0) {
-        printf("SDL Initialization failed:%s.\n", SDL_GetError());
-        exit(EXIT_FAILURE);
+    if (NULL != stream_path) {
+        if (EXIT_SUCCESS != chip8_stream_open(&stream, stream_path))
+            exit(EXIT_FAILURE);
+        streamp = &stream;
     }
 
-    SDL_Window *window = SDL_CreateWindow("Hello, World!",
-        100, 100, 640, 320, SDL_WINDOW_SHOWN);
-    if (window == NULL) {
-            printf("SDL Window creation failed: %s.\n",  SDL_GetError());
-            SDL_Quit();
+    if (stats_flag) {
+        const char *rom = strrchr(binary, '/');
+        stats = chip8_stats_open(rom ? rom + 1 : binary);
+        if (NULL == stats)
             exit(EXIT_FAILURE);
     }
 
-    SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED|SDL_RENDERER_PRESENTVSYNC);
-    if (renderer == NULL) {
-            printf("SDL Renderer creation failed: %s.\n",  SDL_GetError());
-            SDL_Quit();
-            exit(EXIT_FAILURE);
+    if (headless_frames) {
+        chip8_block_to_mem(&chip, CHIP8E_MEM_OFFSET_PROGRAM_START, file_buf, size);
+        if (fuse_flag)
+            chip8_fusion_attach(&chip, &fusion);
+        if (watch_flag)
+            chip8_watchdog_attach(&chip, &wd, budget);
+        int result = run_headless(&chip, headless_frames, streamp, stats);
+        if (watch_flag)
+            result = report_exit(&chip);
+        if (streamp)
+            chip8_stream_close(streamp);
+        if (stats) {
+            chip8_stats_state(stats, &chip);
+            chip8_stats_close(stats, chip.state == CHIP_STATE_EXCEPTION);
+        }
+        return result;
     }
 
+    if (EXIT_SUCCESS != display->open())
+        exit(EXIT_FAILURE);
+
     chip8_block_to_mem(&chip, CHIP8E_MEM_OFFSET_PROGRAM_START, file_buf, size);
 
-    // Start executing program code
-    while (chip.state == CHIP_STATE_NORMAL) {
-        SDL_Event event;
-        while (SDL_PollEvent(&event)) {
-            switch (event.type) {
-                case SDL_QUIT:
-                    printf("Quit event.\n");
-                    chip.state = CHIP_STATE_EXIT;
-                    SDL_FlushEvents(SDL_FIRSTEVENT, SDL_LASTEVENT);
-                break;
-                case SDL_KEYDOWN:
-                case SDL_KEYUP:
-                    printf("Key down event: %x %x.\n", event.key.keysym.sym, SDLK_ESCAPE);
-                    switch (event.key.keysym.sym) {
-                        case SDLK_ESCAPE:
-                            chip.state = CHIP_STATE_EXIT;
-                        break;
-                    }
-                SDL_FlushEvents(SDL_FIRSTEVENT, SDL_LASTEVENT);
-                break;
-                default:
-                    SDL_FlushEvents(SDL_FIRSTEVENT, SDL_LASTEVENT);
-                break;
-            }
-            SDL_RenderPresent(renderer);
+    if (fuse_flag)
+        chip8_fusion_attach(&chip, &fusion);
 
-            chip8_cycle(&chip);
-            if (chip.DT > 0)
-                chip.DT --;
+    if (watch_flag)
+        chip8_watchdog_attach(&chip, &wd, budget);
 
-            if (chip.ST > 0) {
-                if (1 == chip.ST) {
-                // TODO beep
-                printf("Beep!\n");
-                }
-                chip.ST --;
-            }
+    if (debug_flag) {
+        chip8_debug_attach(&chip, &dbg);
+        chip8_debug_break(&chip, CHIP8E_BREAK_USER, chip.PC);
+    }
 
-            if (chip.video_dirty) {
-                redraw(renderer, chip.video_buffer);
-                chip.video_dirty = false;
-            }
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    uint64_t last = stats ? chip8_stats_now() : 0;
+
+    // Start executing program code, one frame per iteration
+    while (chip.state == CHIP_STATE_NORMAL || chip.state == CHIP_STATE_BREAK) {
+        if (chip.state == CHIP_STATE_BREAK) {
+            chip8_debug_console(&chip);
+            clock_gettime(CLOCK_MONOTONIC, &deadline);
+            continue;
+        }
+
+        int events = display->input(&chip.keys);
+        if (events & CHIP8E_DISPLAY_QUIT)
+            chip.state = CHIP_STATE_EXIT;
+        else if (debug_flag && (events & CHIP8E_DISPLAY_BREAK))
+            chip8_debug_break(&chip, CHIP8E_BREAK_USER, chip.PC);
+        if (chip.state != CHIP_STATE_NORMAL)
+            continue;
+
+        if (streamp)
+            chip8_stream_poll(streamp, &chip);
+
+        // DT and ST count down inside the frame on the emulated clock
+        uint8_t sound = chip.ST;
+        run_frame(&chip);
+
+        // No audio yet, a beep is reported once when the tone starts
+        if (sound_flag && 0 == sound && chip.ST > 0)
+            printf("Beep!\n");
+
+        uint64_t present = 0;
+        if (chip.video_dirty) {
+            uint64_t start = stats ? chip8_stats_now() : 0;
+            CHIP8E_PROBE(present_start, chip.PC, chip.opcode, chip.cycles, chip.frames);
+            display->present(chip.video_buffer);
+            CHIP8E_PROBE(present_done, chip.PC, chip.opcode, chip.cycles, chip.frames);
+            chip.video_dirty = false;
+            if (stats)
+                present = chip8_stats_now() - start;
+        }
+        if (streamp)
+            chip8_stream_publish(streamp, &chip);
 
-            if (nanosleep(&(chip.cmd_delay_ts), NULL))
-                printf("Sleep interrupted.");
+        int64_t overshoot = pace_frame(&chip, &deadline);
+        if (stats) {
+            uint64_t now = chip8_stats_now();
+            chip8_stats_frame(stats, &chip, now - last, present, overshoot);
+            last = now;
         }
     }
 
+    if (streamp)
+        chip8_stream_close(streamp);
+
+    display->close();
+
+    if (stats) {
+        chip8_stats_state(stats, &chip);
+        chip8_stats_close(stats, chip.state == CHIP_STATE_EXCEPTION);
+    }
+
     if (chip.state == CHIP_STATE_EXCEPTION) {
         chip8_trap(&chip);
     }
 
-    SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
-    SDL_Quit();
-
+    if (watch_flag)
+        return report_exit(&chip);
     return(EXIT_SUCCESS);
 }
 
@@ -151,8 +403,19 @@ int main(int argc, char*argv[])
     }
 
     bool sound_flag = 1;
+    bool debug_flag = 0;
+    bool fuse_flag = 0;
+    chip8_timing_t timing = CHIP8E_TIMING_VIP;
+    uint32_t ips = CHIP8E_FIXED_IPS_DEFAULT;
+    uint64_t headless_frames = 0;
+    char *stream_path = NULL;
+    const chip8_display_t *display = &chip8_display_sdl;
+    bool stats_flag = 0;
+    bool watch_flag = 0;
+    uint64_t budget = 0;
+    int grid = 0;
     int ch;
-    while ((ch = getopt(argc, argv, "p:nh")) != -1) {
+    while ((ch = getopt(argc, argv, "p:ndfr:s:t:i:H:S:TWB:g:h")) != -1) {
         switch (ch) {
             case 'p':
                 binary = strdup(optarg);
@@ -165,6 +428,76 @@ int main(int argc, char*argv[])
                 sound_flag = 0;
                 printf("Sound disabled.\n");
             break;
+            case 'd':
+                debug_flag = 1;
+            break;
+            case 'f':
+                fuse_flag = 1;
+            break;
+            case 'r':
+                if (0 == strcmp(optarg, chip8_display_sdl.name)) {
+                    display = &chip8_display_sdl;
+                } else if (0 == strcmp(optarg, chip8_display_term.name)) {
+                    display = &chip8_display_term;
+                } else {
+                    printf("Unknown display %s.\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+            break;
+            case 's': {
+                chip8_scale_filter_t filter = chip8_scale_parse(optarg);
+                if (CHIP8E_SCALE_FILTERS == filter) {
+                    printf("Unknown filter %s.\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                chip8_display_sdl_filter(filter);
+            }
+            break;
+            case 't':
+                if (0 == strcmp(optarg, "vip")) {
+                    timing = CHIP8E_TIMING_VIP;
+                } else if (0 == strcmp(optarg, "fixed")) {
+                    timing = CHIP8E_TIMING_FIXED;
+                } else {
+                    printf("Unknown timing model %s.\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+            break;
+            case 'i':
+                ips = strtoul(optarg, NULL, 0);
+                if (0 == ips) {
+                    printf("Invalid instructions per second %s.\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                timing = CHIP8E_TIMING_FIXED;
+            break;
+            case 'H':
+                headless_frames = strtoull(optarg, NULL, 0);
+            break;
+            case 'S':
+                stream_path = optarg;
+            break;
+            case 'T':
+                stats_flag = 1;
+            break;
+            case 'W':
+                watch_flag = 1;
+            break;
+            case 'B':
+                budget = strtoull(optarg, NULL, 0);
+                if (0 == budget) {
+                    printf("Invalid instruction budget %s.\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                watch_flag = 1;
+            break;
+            case 'g':
+                grid = atoi(optarg);
+                if (grid < 1 || grid > CHIP8E_GRID_MAX) {
+                    printf("Grid of 1 to %d machines.\n", CHIP8E_GRID_MAX);
+                    exit(EXIT_FAILURE);
+                }
+            break;
             case 'h':
             case '?':
             default:
@@ -174,8 +507,36 @@ int main(int argc, char*argv[])
         }
     }
 
+    // The console reads the same terminal the display draws on
+    if (debug_flag && display == &chip8_display_term) {
+        printf("The debugger needs the SDL display.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (grid && NULL != binary) {
+        if (debug_flag || headless_frames || stream_path || stats_flag || watch_flag) {
+            printf("-d, -H, -S, -T and -W need a single machine.\n");
+            exit(EXIT_FAILURE);
+        }
+        if (NULL == display->present_grid) {
+            printf("The %s display cannot show a grid.\n", display->name);
+            exit(EXIT_FAILURE);
+        }
+        // The -p binary, then the operands
+        char *binaries[CHIP8E_GRID_MAX];
+        int binary_count = 0;
+        binaries[binary_count++] = binary;
+        for (int i = optind; i < argc && binary_count < CHIP8E_GRID_MAX; i++)
+            binaries[binary_count++] = argv[i];
+        int result = run_grid(binaries, binary_count, grid, fuse_flag, timing, ips, display);
+        free(binary);
+        return result;
+    }
+
     if (NULL != binary) {
-        int result = execute_binary(binary, sound_flag);
+        int result = execute_binary(binary, sound_flag, debug_flag, fuse_flag,
+            timing, ips, headless_frames, stream_path,
+            display, stats_flag, watch_flag, budget);
         free(binary);
         return result;
     } else {
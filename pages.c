@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "chip8.h"
+#include "pages.h"
+
+static uint64_t live;
+
+static chip8_page_p chip8_page_new(const uint8_t *data)
+{
+    chip8_page_p page = malloc(sizeof(chip8_page_t));
+    if (NULL == page)
+        return NULL;
+    page->refs = 1;
+    memcpy(page->data, data, CHIP8E_PAGE_SIZE);
+    live++;
+    return page;
+}
+
+static void chip8_page_put(chip8_page_p page)
+{
+    if (page && 0 == --page->refs) {
+        free(page);
+        live--;
+    }
+}
+
+// Write one page of a slice back, false if out of memory
+static bool chip8_page_update(chip8_page_p *slot, const uint8_t *data)
+{
+    chip8_page_p page = *slot;
+    if (!memcmp(page->data, data, CHIP8E_PAGE_SIZE))
+        return true;
+    if (page->refs == 1) {
+        memcpy(page->data, data, CHIP8E_PAGE_SIZE);
+        return true;
+    }
+    chip8_page_p copy = chip8_page_new(data);
+    if (NULL == copy)
+        return false;
+    page->refs--;
+    *slot = copy;
+    return true;
+}
+
+// Pages of a table that repeat one already saved share it
+static int chip8_paged_table(chip8_page_p *table, int count, const uint8_t *data)
+{
+    for (int p = 0; p < count; p++) {
+        const uint8_t *src = data + p * CHIP8E_PAGE_SIZE;
+        table[p] = NULL;
+        for (int q = 0; q < p; q++) {
+            if (!memcmp(table[q]->data, src, CHIP8E_PAGE_SIZE)) {
+                table[p] = table[q];
+                table[p]->refs++;
+                break;
+            }
+        }
+        if (NULL == table[p] && NULL == (table[p] = chip8_page_new(src)))
+            return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+static void chip8_paged_registers(chip8_paged_p paged, chip8_p chip)
+{
+    memcpy(paged->stack, chip->stack, sizeof(paged->stack));
+    memcpy(paged->V, chip->V, sizeof(paged->V));
+    paged->opcode = chip->opcode;
+    paged->I = chip->I;
+    paged->PC = chip->PC;
+    paged->keys = chip->keys;
+    paged->SP = chip->SP;
+    paged->DT = chip->DT;
+    paged->ST = chip->ST;
+    paged->seed = chip->seed;
+    paged->state = chip->state;
+    paged->instructions = chip->instructions;
+    paged->timing = chip->timing;
+    paged->frame_cycles = chip->frame_cycles;
+    paged->cycles = chip->cycles;
+    paged->next_frame = chip->next_frame;
+    paged->frames = chip->frames;
+}
+
+int chip8_paged_save(chip8_paged_p paged, chip8_p chip)
+{
+    memset(paged, 0x00, sizeof(*paged));
+    chip8_paged_registers(paged, chip);
+
+    if (EXIT_SUCCESS != chip8_paged_table(paged->memory, CHIP8E_PAGE_COUNT, chip->memory)
+        || EXIT_SUCCESS != chip8_paged_table(paged->video, CHIP8E_VIDEO_PAGES, chip->video_buffer)) {
+        chip8_paged_free(paged);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+void chip8_paged_fork(chip8_paged_p dst, const chip8_paged_t *src)
+{
+    *dst = *src;
+    for (int p = 0; p < CHIP8E_PAGE_COUNT; p++)
+        dst->memory[p]->refs++;
+    for (int p = 0; p < CHIP8E_VIDEO_PAGES; p++)
+        dst->video[p]->refs++;
+}
+
+void chip8_paged_free(chip8_paged_p paged)
+{
+    for (int p = 0; p < CHIP8E_PAGE_COUNT; p++)
+        chip8_page_put(paged->memory[p]);
+    for (int p = 0; p < CHIP8E_VIDEO_PAGES; p++)
+        chip8_page_put(paged->video[p]);
+    memset(paged->memory, 0x00, sizeof(paged->memory));
+    memset(paged->video, 0x00, sizeof(paged->video));
+}
+
+void chip8_paged_load(const chip8_paged_t *paged, chip8_p chip)
+{
+    for (int p = 0; p < CHIP8E_PAGE_COUNT; p++)
+        memcpy(chip->memory + p * CHIP8E_PAGE_SIZE, paged->memory[p]->data, CHIP8E_PAGE_SIZE);
+    for (int p = 0; p < CHIP8E_VIDEO_PAGES; p++)
+        memcpy(chip->video_buffer + p * CHIP8E_PAGE_SIZE, paged->video[p]->data, CHIP8E_PAGE_SIZE);
+    memcpy(chip->stack, paged->stack, sizeof(chip->stack));
+    memcpy(chip->V, paged->V, sizeof(chip->V));
+    chip->opcode = paged->opcode;
+    chip->I = paged->I;
+    chip->PC = paged->PC;
+    chip->keys = paged->keys;
+    chip->SP = paged->SP;
+    chip->DT = paged->DT;
+    chip->ST = paged->ST;
+    chip->seed = paged->seed;
+    chip->state = paged->state;
+    chip->instructions = paged->instructions;
+    chip->timing = paged->timing;
+    chip->frame_cycles = paged->frame_cycles;
+    chip->cycles = paged->cycles;
+    chip->next_frame = paged->next_frame;
+    chip->frames = paged->frames;
+    chip->debug = NULL;
+    chip->fusion = NULL;
+    chip->watchdog = NULL;
+    chip->video_dirty = false;
+    chip->dirty_pages = 0;
+}
+
+int chip8_paged_store(chip8_paged_p paged, chip8_p chip)
+{
+    for (int p = 0; p < CHIP8E_PAGE_COUNT; p++)
+        if ((chip->dirty_pages & (1 << p))
+            && !chip8_page_update(&paged->memory[p], chip->memory + p * CHIP8E_PAGE_SIZE))
+            return EXIT_FAILURE;
+    // CLS and DRW set video_dirty, not which rows they touched
+    if (chip->video_dirty)
+        for (int p = 0; p < CHIP8E_VIDEO_PAGES; p++)
+            if (!chip8_page_update(&paged->video[p], chip->video_buffer + p * CHIP8E_PAGE_SIZE))
+                return EXIT_FAILURE;
+    chip->dirty_pages = 0;
+    chip->video_dirty = false;
+
+    chip8_paged_registers(paged, chip);
+    return EXIT_SUCCESS;
+}
+
+uint64_t chip8_paged_live(void)
+{
+    return live;
+}
@@ -0,0 +1,61 @@
+#ifndef __PAGES_H
+#define __PAGES_H
+
+#include "chip8.h"
+
+/**
+ * Machines at rest in copy on write pages, for fleets of instances.
+ *
+ * A chip8_paged_t holds registers and two page tables, one for memory
+ * and one for the display, of CHIP8E_PAGE_SIZE byte pages. Pages are
+ * reference counted: chip8_paged_fork() copies the tables and takes a
+ * reference on every page, so a fork costs its registers and tables and
+ * nothing else. Mostly the ROM, font and display stay shared for the
+ * whole run.
+ *
+ * Instances run on an ordinary chip8_t: chip8_paged_load() flattens the
+ * pages into it, chip8_paged_store() writes the slice back. The stores
+ * (LD B, LD [I] and program loads) mark their page in chip->dirty_pages
+ * and only those pages are written back; a page still shared with
+ * another instance is copied first. Fetch and reads run on flat memory
+ * with no indirection.
+ *
+ * Not thread safe: references are plain counters, one thread owns a
+ * fleet.
+ **/
+
+#define CHIP8E_VIDEO_PAGES (CHIP8E_XRES * CHIP8E_YRES / CHIP8E_PAGE_SIZE)
+
+typedef struct chip8_page {
+    uint32_t refs;
+    uint8_t data[CHIP8E_PAGE_SIZE];
+} chip8_page_t, *chip8_page_p;
+
+typedef struct {
+    chip8_page_p memory[CHIP8E_PAGE_COUNT];
+    chip8_page_p video[CHIP8E_VIDEO_PAGES];
+    uint16_t stack[CHIP8E_STACK_SIZE];
+    uint8_t V[16];
+    uint16_t opcode, I, PC, keys;
+    uint8_t SP, DT, ST;
+    unsigned int seed;
+    chip8_state_t state;
+    uint64_t instructions;
+    chip8_timing_t timing;
+    uint32_t frame_cycles;
+    uint64_t cycles, next_frame, frames;
+} chip8_paged_t, *chip8_paged_p;
+
+// Snapshot a machine into new pages, identical pages are stored once
+int chip8_paged_save(chip8_paged_p paged, chip8_p chip);
+// Share every page of src with dst
+void chip8_paged_fork(chip8_paged_p dst, const chip8_paged_t *src);
+void chip8_paged_free(chip8_paged_p paged);
+// Run an instance: flatten it into chip, which needs no other init
+void chip8_paged_load(const chip8_paged_t *paged, chip8_p chip);
+// Write the changes of a slice back, copying pages that are shared
+int chip8_paged_store(chip8_paged_p paged, chip8_p chip);
+// Pages currently allocated
+uint64_t chip8_paged_live(void);
+
+#endif // __PAGES_H
@@ -0,0 +1,52 @@
+#ifndef __PROBES_H
+#define __PROBES_H
+
+/**
+ * Static tracepoints (USDT) for perf and bpftrace, provider chip8e.
+ *
+ * With <sys/sdt.h> (systemtap-sdt-dev) at build time every probe is a
+ * single nop plus a note in the ELF file naming its location and where
+ * its arguments live; nothing runs until a tracer arms it. Without the
+ * header, or with -DCHIP8E_NO_PROBES, the probes and their arguments are
+ * compiled out. Arguments are values already at hand, so a disarmed probe
+ * costs the nop and no more. Durations come from pairs of probes.
+ *
+ * Every probe starts with the machine's pc, opcode and cycles, the
+ * emulated clock (see timing.h); for the frontend probes that is where
+ * the machine stands, for rom_load before the program is loaded. Then:
+ *
+ *  dispatch                        every interpreted instruction
+ *  drw                             DRW, before the sprite is drawn
+ *  push(sp)                        CALL, after the push
+ *  pop(sp)                         RET, after the pop
+ *  rom_load_start(filename)        a program file is opened
+ *  rom_load_done(filename, size)   and read, size -1 on error
+ *  present_start(frames)           the frontend hands a frame over
+ *  present_done(frames)            and gets control back
+ *  pace_start(ns)                  ns to the frame deadline, < 0 late
+ *  pace_done(ns)                   woke up ns late, -1 if no sleep
+ *
+ * frames counts 60 Hz interrupts. In grid mode (-g) the frontend probes
+ * carry the selected machine. Fused instructions (-f) and translated
+ * code (chip8e-aot) do not pass dispatch. List the probes of a binary
+ * with
+ *
+ *     bpftrace -l 'usdt:./chip8e:*'
+ *
+ * and see bpftrace/ for scripts.
+ **/
+
+#if !defined(CHIP8E_NO_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define CHIP8E_PROBE(name, ...) STAP_PROBEV(chip8e, name, __VA_ARGS__)
+#endif
+#endif
+
+// Compiled out: the arguments count as used but are never evaluated
+#ifndef CHIP8E_PROBE
+static inline void chip8_probe_none(int n, ...) { (void)n; }
+#define CHIP8E_PROBE(name, ...) do { if (0) chip8_probe_none(0, __VA_ARGS__); } while (0)
+#endif
+
+#endif // __PROBES_H
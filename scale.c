@@ -0,0 +1,253 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "chip8.h"
+#include "scale.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define CHIP8E_SCALE_SSE2
+#endif
+
+// Widest output row: the largest source scaled to an 8K display
+#define CHIP8E_SCALE_MAX_ROW 8192
+// Border around the EPX input, wide enough for loads at x - 1 and x + 1
+#define CHIP8E_SCALE_PAD 16
+#define CHIP8E_SCALE_PAD_W (CHIP8E_SCALE_MAX_W + 2 * CHIP8E_SCALE_PAD)
+
+static const char *names[CHIP8E_SCALE_FILTERS] = {
+    "nearest", "scale2x", "scale3x", "scanline", "grid"
+};
+
+// Masks of lit pixels, a pixel is 0x00 or 0xFF. Operations on masks are
+// plain bitwise ones, equality is NOT XOR, so the EPX rules below work
+// the same on 16 pixels in an SSE2 register or 8 in a 64 bit word.
+#ifdef CHIP8E_SCALE_SSE2
+typedef __m128i vmask_t;
+#define VN 16
+#define VLOAD(p)        _mm_loadu_si128((const __m128i *)(p))
+#define VSTORE(p, v)    _mm_storeu_si128((__m128i *)(p), v)
+#define VAND(a, b)      _mm_and_si128(a, b)
+#define VOR(a, b)       _mm_or_si128(a, b)
+#define VXOR(a, b)      _mm_xor_si128(a, b)
+#define VANDNOT(a, b)   _mm_andnot_si128(a, b)
+#define VONES           _mm_set1_epi8(-1)
+#else
+typedef uint64_t vmask_t;
+#define VN 8
+static inline vmask_t VLOAD(const uint8_t *p) { vmask_t v; memcpy(&v, p, sizeof(v)); return v; }
+#define VSTORE(p, v)    do { vmask_t t_ = (v); memcpy(p, &t_, sizeof(t_)); } while (0)
+#define VAND(a, b)      ((a) & (b))
+#define VOR(a, b)       ((a) | (b))
+#define VXOR(a, b)      ((a) ^ (b))
+#define VANDNOT(a, b)   (~(a) & (b))
+#define VONES           (~(uint64_t)0)
+#endif
+
+#define VEQ(a, b)       VXOR(VXOR(a, b), VONES)
+#define VNE(a, b)       VXOR(a, b)
+// c ? a : b, lane by lane
+#define VSEL(c, a, b)   VOR(VAND(c, a), VANDNOT(c, b))
+
+static uint8_t pad[CHIP8E_SCALE_MAX_H + 2][CHIP8E_SCALE_PAD_W];
+static uint8_t epx[CHIP8E_SCALE_MAX_H * 3][CHIP8E_SCALE_MAX_W * 3];
+// One output row, kept in cacheable memory: texture memory may be write
+// combined and slow to read back
+static uint32_t row[CHIP8E_SCALE_MAX_ROW];
+static uint32_t dim_row[CHIP8E_SCALE_MAX_ROW];
+
+chip8_scale_filter_t chip8_scale_parse(const char *name)
+{
+    for (int f = 0; f < CHIP8E_SCALE_FILTERS; f++)
+        if (0 == strcmp(name, names[f]))
+            return f;
+    return CHIP8E_SCALE_FILTERS;
+}
+
+const char *chip8_scale_name(chip8_scale_filter_t filter)
+{
+    return (filter < CHIP8E_SCALE_FILTERS) ? names[filter] : "unknown";
+}
+
+// EPX stage of the filter, 1 for none
+static int chip8_scale_epx_factor(chip8_scale_filter_t filter)
+{
+    switch (filter) {
+        case CHIP8E_SCALE_EPX2: return 2;
+        case CHIP8E_SCALE_EPX3: return 3;
+        default: return 1;
+    }
+}
+
+int chip8_scale_factor(chip8_scale_filter_t filter, int w, int h, int dst_w, int dst_h)
+{
+    int k = chip8_scale_epx_factor(filter);
+    int f = (dst_w / w < dst_h / h) ? dst_w / w : dst_h / h;
+    if (f * w > CHIP8E_SCALE_MAX_ROW)
+        f = CHIP8E_SCALE_MAX_ROW / w;
+    return (f < k) ? k : f - f % k;
+}
+
+// Source as masks with the edge pixels repeated into the border
+static void chip8_scale_pad(const uint8_t *src, int w, int h)
+{
+    for (int y = -1; y <= h; y++) {
+        int sy = (y < 0) ? 0 : (y >= h) ? h - 1 : y;
+        uint8_t *p = pad[y + 1] + CHIP8E_SCALE_PAD;
+        for (int x = 0; x < w; x++)
+            p[x] = src[sy * w + x] ? 0xFF : 0x00;
+        p[-1] = p[0];
+        p[w] = p[w - 1];
+    }
+}
+
+static void chip8_scale_epx2(const uint8_t *src, int w, int h)
+{
+    uint8_t e[4][VN];
+
+    chip8_scale_pad(src, w, h);
+    for (int y = 0; y < h; y++) {
+        const uint8_t *up = pad[y] + CHIP8E_SCALE_PAD;
+        const uint8_t *mid = pad[y + 1] + CHIP8E_SCALE_PAD;
+        const uint8_t *down = pad[y + 2] + CHIP8E_SCALE_PAD;
+        for (int x = 0; x < w; x += VN) {
+            vmask_t B = VLOAD(up + x), H = VLOAD(down + x);
+            vmask_t D = VLOAD(mid + x - 1), E = VLOAD(mid + x), F = VLOAD(mid + x + 1);
+            vmask_t c = VAND(VNE(B, H), VNE(D, F));
+
+            VSTORE(e[0], VSEL(VAND(c, VEQ(D, B)), D, E));
+            VSTORE(e[1], VSEL(VAND(c, VEQ(B, F)), F, E));
+            VSTORE(e[2], VSEL(VAND(c, VEQ(D, H)), D, E));
+            VSTORE(e[3], VSEL(VAND(c, VEQ(H, F)), F, E));
+            for (int i = 0; i < VN; i++) {
+                uint8_t *o = &epx[2 * y][2 * (x + i)];
+                o[0] = e[0][i];
+                o[1] = e[1][i];
+                o += sizeof(epx[0]);
+                o[0] = e[2][i];
+                o[1] = e[3][i];
+            }
+        }
+    }
+}
+
+static void chip8_scale_epx3(const uint8_t *src, int w, int h)
+{
+    uint8_t e[9][VN];
+
+    chip8_scale_pad(src, w, h);
+    for (int y = 0; y < h; y++) {
+        const uint8_t *up = pad[y] + CHIP8E_SCALE_PAD;
+        const uint8_t *mid = pad[y + 1] + CHIP8E_SCALE_PAD;
+        const uint8_t *down = pad[y + 2] + CHIP8E_SCALE_PAD;
+        for (int x = 0; x < w; x += VN) {
+            vmask_t A = VLOAD(up + x - 1), B = VLOAD(up + x), C = VLOAD(up + x + 1);
+            vmask_t D = VLOAD(mid + x - 1), E = VLOAD(mid + x), F = VLOAD(mid + x + 1);
+            vmask_t G = VLOAD(down + x - 1), H = VLOAD(down + x), I = VLOAD(down + x + 1);
+            vmask_t c = VAND(VNE(B, H), VNE(D, F));
+            vmask_t db = VAND(c, VEQ(D, B)), bf = VAND(c, VEQ(B, F));
+            vmask_t dh = VAND(c, VEQ(D, H)), hf = VAND(c, VEQ(H, F));
+
+            VSTORE(e[0], VSEL(db, D, E));
+            VSTORE(e[1], VSEL(VOR(VAND(db, VNE(E, C)), VAND(bf, VNE(E, A))), B, E));
+            VSTORE(e[2], VSEL(bf, F, E));
+            VSTORE(e[3], VSEL(VOR(VAND(db, VNE(E, G)), VAND(dh, VNE(E, A))), D, E));
+            VSTORE(e[4], E);
+            VSTORE(e[5], VSEL(VOR(VAND(bf, VNE(E, I)), VAND(hf, VNE(E, C))), F, E));
+            VSTORE(e[6], VSEL(dh, D, E));
+            VSTORE(e[7], VSEL(VOR(VAND(dh, VNE(E, I)), VAND(hf, VNE(E, G))), H, E));
+            VSTORE(e[8], VSEL(hf, F, E));
+            for (int i = 0; i < VN; i++)
+                for (int j = 0; j < 9; j++)
+                    epx[3 * y + j / 3][3 * (x + i) + j % 3] = e[j][i];
+        }
+    }
+}
+
+static inline uint32_t chip8_scale_dim(uint32_t c)
+{
+    return ((c >> 1) & 0x007F7F7F) | (c & 0xFF000000);
+}
+
+// n pixels of color c
+static inline void chip8_scale_span(uint32_t *d, uint32_t c, int n)
+{
+#ifdef CHIP8E_SCALE_SSE2
+    if (n >= 4) {
+        __m128i v = _mm_set1_epi32(c);
+        int k = 0;
+        for (; k + 4 <= n; k += 4)
+            _mm_storeu_si128((__m128i *)(d + k), v);
+        // Overlapping tail, still inside the span
+        if (k < n)
+            _mm_storeu_si128((__m128i *)(d + n - 4), v);
+        return;
+    }
+#endif
+    for (int k = 0; k < n; k++)
+        d[k] = c;
+}
+
+// Expand one row of the image, each pixel f wide; with edge set the
+// last column of every pixel is dimmed
+static void chip8_scale_row(uint32_t *d, const uint8_t *img, int w, int f,
+    uint32_t on, uint32_t off, bool edge)
+{
+    // Unscaled, the grid atlas: a plain select the compiler vectorizes
+    if (1 == f) {
+        for (int x = 0; x < w; x++)
+            d[x] = img[x] ? on : off;
+        return;
+    }
+    for (int x = 0; x < w; x++, d += f) {
+        uint32_t c = img[x] ? on : off;
+        if (edge && f > 1) {
+            chip8_scale_span(d, c, f - 1);
+            d[f - 1] = chip8_scale_dim(c);
+        } else {
+            chip8_scale_span(d, c, f);
+        }
+    }
+}
+
+void chip8_scale(chip8_scale_filter_t filter, const uint8_t *src, int w, int h,
+    int factor, uint32_t *dst, int pitch, uint32_t on, uint32_t off)
+{
+    const uint8_t *img = src;
+    int stride = w;
+    int k = chip8_scale_epx_factor(filter);
+    int f = factor / k;
+
+    if (w > CHIP8E_SCALE_MAX_W || h > CHIP8E_SCALE_MAX_H || w % 16 || f < 1
+        || w * factor > CHIP8E_SCALE_MAX_ROW)
+        return;
+
+    if (2 == k)
+        chip8_scale_epx2(src, w, h);
+    else if (3 == k)
+        chip8_scale_epx3(src, w, h);
+    if (k > 1) {
+        img = epx[0];
+        stride = sizeof(epx[0]);
+        w *= k;
+        h *= k;
+    }
+
+    bool scanline = (filter == CHIP8E_SCALE_SCANLINE || filter == CHIP8E_SCALE_GRID) && f > 1;
+    bool grid = (filter == CHIP8E_SCALE_GRID);
+    int n = w * f;
+    uint8_t *out = (uint8_t *)dst;
+
+    for (int y = 0; y < h; y++, img += stride) {
+        chip8_scale_row(row, img, w, f, on, off, grid);
+        if (scanline)
+            chip8_scale_row(dim_row, img, w, f, chip8_scale_dim(on), chip8_scale_dim(off), false);
+        for (int r = 0; r < f; r++, out += pitch) {
+            const uint32_t *line = (scanline && r == f - 1) ? dim_row : row;
+            memcpy(out, line, n * sizeof(uint32_t));
+        }
+    }
+}
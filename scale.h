@@ -0,0 +1,48 @@
+#ifndef __SCALE_H
+#define __SCALE_H
+
+#include "chip8.h"
+
+/**
+ * Integer upscaling of the video buffer into 32 bit pixels.
+ *
+ * The source is one byte per pixel, non zero is lit, up to
+ * CHIP8E_SCALE_MAX_W x CHIP8E_SCALE_MAX_H with a width that is a multiple
+ * of 16. Every filter builds one output row per source row in a cached
+ * buffer and copies it down for the remaining rows of that pixel, so the
+ * cost is dominated by the copies. Those are memcpy(), which libc already
+ * runs with the widest stores the CPU has; non temporal stores measured
+ * slower, the renderer reads the texture right after. Building the rows
+ * (pixel spans and the EPX rules) uses SSE2 where available.
+ *
+ * Scale2x and Scale3x (EPX) first smooth diagonals at 2x or 3x with
+ * vector compares over masks, then scale the result by the remaining
+ * factor. Scanline dims the last output row of every pixel, grid also
+ * the last column.
+ *
+ * Not reentrant, the EPX stages use static buffers.
+ **/
+
+#define CHIP8E_SCALE_MAX_W 128
+#define CHIP8E_SCALE_MAX_H 64
+
+typedef enum {
+    CHIP8E_SCALE_NEAREST,
+    CHIP8E_SCALE_EPX2,
+    CHIP8E_SCALE_EPX3,
+    CHIP8E_SCALE_SCANLINE,
+    CHIP8E_SCALE_GRID,
+    CHIP8E_SCALE_FILTERS
+} chip8_scale_filter_t;
+
+// Filter by name, CHIP8E_SCALE_FILTERS if there is none
+chip8_scale_filter_t chip8_scale_parse(const char *name);
+const char *chip8_scale_name(chip8_scale_filter_t filter);
+// Largest factor of the filter that fits w x h into dst_w x dst_h, at
+// least the filter's own 2 or 3 for EPX and 1 otherwise
+int chip8_scale_factor(chip8_scale_filter_t filter, int w, int h, int dst_w, int dst_h);
+// Scale src by factor into dst, pitch is in bytes
+void chip8_scale(chip8_scale_filter_t filter, const uint8_t *src, int w, int h,
+    int factor, uint32_t *dst, int pitch, uint32_t on, uint32_t off);
+
+#endif // __SCALE_H
@@ -3,6 +3,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "stack.h"
+#include "probes.h"
 
 int chip8_stack_init(chip8_p chip) 
 {
@@ -14,25 +15,29 @@ int chip8_stack_init(chip8_p chip)
 }
 int chip8_stack_push(chip8_p chip, uint16_t n)
 {
+	// Overflow and underflow are traps, the caller leaves PC on the
+	// instruction that raised them
 	if (chip->SP == CHIP8E_STACK_SIZE) {
-		printf("Stack full!\n");
+		chip->state = CHIP_STATE_EXCEPTION;
 		return EXIT_FAILURE;
 	}
 	// printf("Push:[%d]=%d\n", chip->SP, n);	
 	chip->stack[chip->SP] = n;
 	chip->SP++;
+	CHIP8E_PROBE(push, chip->PC, chip->opcode, chip->cycles, chip->SP);
 	return EXIT_SUCCESS;
 }
 
 int chip8_stack_pop(chip8_p chip, uint16_t *np)
 {
 	if (chip->SP == 0) {
-		printf("Stack empty!\n");
+		chip->state = CHIP_STATE_EXCEPTION;
 		return EXIT_FAILURE;
 	}
 	
 	chip->SP--;	
 	*np = chip->stack[chip->SP];
+	CHIP8E_PROBE(pop, chip->PC, chip->opcode, chip->cycles, chip->SP);
 	// printf("Pop:[%d]=%d\n", chip->SP, *np);		
 
 	return EXIT_SUCCESS;
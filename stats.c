@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "chip8.h"
+#include "stats.h"
+
+// Snapshot attempts before a reader gives up
+#define CHIP8E_STATS_RETRIES 1000
+
+static char name[32];
+
+uint64_t chip8_stats_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+chip8_stats_p chip8_stats_open(const char *rom)
+{
+    snprintf(name, sizeof(name), CHIP8E_STATS_PREFIX "%d", (int)getpid());
+    int fd = shm_open(name, O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0) {
+        printf("Cannot create %s: %s\n", name, strerror(errno));
+        return NULL;
+    }
+    if (ftruncate(fd, sizeof(chip8_stats_t)) < 0) {
+        printf("Cannot size %s: %s\n", name, strerror(errno));
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+    chip8_stats_p stats = mmap(NULL, sizeof(chip8_stats_t),
+        PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == stats) {
+        printf("Cannot map %s: %s\n", name, strerror(errno));
+        shm_unlink(name);
+        return NULL;
+    }
+
+    // Fresh segments are zero filled, magic goes last
+    stats->version = CHIP8E_STATS_VERSION;
+    stats->pid = getpid();
+    snprintf(stats->rom, sizeof(stats->rom), "%s", rom);
+    stats->started = stats->ips_since = stats->updated = chip8_stats_now();
+    __atomic_store_n(&stats->magic, CHIP8E_STATS_MAGIC, __ATOMIC_RELEASE);
+    return stats;
+}
+
+void chip8_stats_close(chip8_stats_p stats, bool keep)
+{
+    munmap(stats, sizeof(chip8_stats_t));
+    if (!keep)
+        shm_unlink(name);
+}
+
+static void chip8_stats_write_begin(chip8_stats_p stats)
+{
+    __atomic_store_n(&stats->seq, stats->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void chip8_stats_write_end(chip8_stats_p stats)
+{
+    __atomic_store_n(&stats->seq, stats->seq + 1, __ATOMIC_RELEASE);
+}
+
+static void chip8_stats_sample(uint64_t *hist, uint64_t ns)
+{
+    uint64_t us = ns / 1000;
+    int bucket = 0;
+    while (us > 0 && bucket < CHIP8E_STATS_BUCKETS - 1) {
+        us >>= 1;
+        bucket++;
+    }
+    hist[bucket]++;
+}
+
+static void chip8_stats_machine(chip8_stats_p stats, chip8_p chip)
+{
+    stats->instructions = chip->instructions;
+    stats->state = chip->state;
+    stats->PC = chip->PC;
+    stats->opcode = chip->opcode;
+}
+
+void chip8_stats_frame(chip8_stats_p stats, chip8_p chip, uint64_t frame,
+    uint64_t present, int64_t overshoot)
+{
+    uint64_t now = chip8_stats_now();
+
+    chip8_stats_write_begin(stats);
+    chip8_stats_machine(stats, chip);
+    stats->frames++;
+    stats->updated = now;
+    chip8_stats_sample(stats->frame_hist, frame);
+    if (present)
+        chip8_stats_sample(stats->present_hist, present);
+    if (CHIP8E_STATS_UNPACED == overshoot) {
+        // Neither dropped nor on time
+    } else if (overshoot < 0) {
+        stats->dropped++;
+    } else {
+        stats->paced++;
+        stats->overshoot_total += overshoot;
+        if ((uint64_t)overshoot > stats->overshoot_max)
+            stats->overshoot_max = overshoot;
+    }
+    if (now - stats->ips_since >= 1000000000ULL) {
+        stats->ips = (chip->instructions - stats->ips_instructions) * 1000000000ULL
+            / (now - stats->ips_since);
+        stats->ips_since = now;
+        stats->ips_instructions = chip->instructions;
+    }
+    chip8_stats_write_end(stats);
+}
+
+void chip8_stats_state(chip8_stats_p stats, chip8_p chip)
+{
+    chip8_stats_write_begin(stats);
+    chip8_stats_machine(stats, chip);
+    stats->updated = chip8_stats_now();
+    stats->ips = 0;
+    chip8_stats_write_end(stats);
+}
+
+const chip8_stats_t *chip8_stats_attach(int pid)
+{
+    char path[32];
+    snprintf(path, sizeof(path), CHIP8E_STATS_PREFIX "%d", pid);
+    int fd = shm_open(path, O_RDONLY, 0);
+    if (fd < 0)
+        return NULL;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(chip8_stats_t)) {
+        close(fd);
+        return NULL;
+    }
+    const chip8_stats_t *stats = mmap(NULL, sizeof(chip8_stats_t), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == stats)
+        return NULL;
+    if (__atomic_load_n(&stats->magic, __ATOMIC_ACQUIRE) != CHIP8E_STATS_MAGIC
+        || stats->version != CHIP8E_STATS_VERSION) {
+        munmap((void *)stats, sizeof(chip8_stats_t));
+        return NULL;
+    }
+    return stats;
+}
+
+void chip8_stats_detach(const chip8_stats_t *stats)
+{
+    munmap((void *)stats, sizeof(chip8_stats_t));
+}
+
+int chip8_stats_snapshot(const chip8_stats_t *stats, chip8_stats_t *copy)
+{
+    for (int i = 0; i < CHIP8E_STATS_RETRIES; i++) {
+        uint32_t seq = __atomic_load_n(&stats->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1)
+            continue;
+        memcpy(copy, (const void *)stats, sizeof(*copy));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&stats->seq, __ATOMIC_RELAXED) == seq)
+            return EXIT_SUCCESS;
+    }
+    return EXIT_FAILURE;
+}
+
+uint64_t chip8_stats_percentile(const uint64_t *hist, double fraction)
+{
+    uint64_t total = 0, seen = 0;
+    for (int b = 0; b < CHIP8E_STATS_BUCKETS; b++)
+        total += hist[b];
+    if (0 == total)
+        return 0;
+    for (int b = 0; b < CHIP8E_STATS_BUCKETS; b++) {
+        seen += hist[b];
+        if (seen >= fraction * total)
+            return 1ULL << b;
+    }
+    return 1ULL << (CHIP8E_STATS_BUCKETS - 1);
+}
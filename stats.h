@@ -0,0 +1,91 @@
+#ifndef __STATS_H
+#define __STATS_H
+
+#include "chip8.h"
+
+/**
+ * Live counters in a POSIX shared memory segment.
+ *
+ * An instance started with -T creates CHIP8E_STATS_PREFIX<pid> and
+ * updates it once per frame, never per instruction. Readers map the
+ * segment read only and take a consistent copy with
+ * chip8_stats_snapshot(): the writer makes seq odd while it updates, a
+ * reader retries until it sees the same even seq before and after
+ * copying. Nothing blocks the writer.
+ *
+ * The segment is removed on a clean exit. After an exception it is kept,
+ * so a monitor still sees the state and PC; chip8e-top -c removes
+ * segments whose process is gone.
+ *
+ * Histograms are log2 buckets of microseconds: bucket 0 counts samples
+ * under 1 us, bucket n those in [2^(n-1), 2^n) us, the last one
+ * everything above.
+ **/
+
+#define CHIP8E_STATS_PREFIX "/chip8e."
+#define CHIP8E_STATS_MAGIC 0x43385354
+#define CHIP8E_STATS_VERSION 2
+#define CHIP8E_STATS_BUCKETS 20
+#define CHIP8E_STATS_ROM_LEN 64
+// Overshoot of a frame that was not paced, headless without -S
+#define CHIP8E_STATS_UNPACED INT64_MIN
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    // Odd while the writer is updating
+    uint32_t seq;
+    int32_t pid;
+    char rom[CHIP8E_STATS_ROM_LEN];
+    // CLOCK_MONOTONIC, ns
+    uint64_t started;
+    uint64_t updated;
+
+    uint64_t instructions;
+    // Instructions per second over the last full second
+    uint64_t ips;
+    uint64_t frames;
+    // Frames that reached the pacing sleep after their deadline
+    uint64_t dropped;
+    // Frames that slept to their deadline, and how far the sleep woke up
+    // after it, ns
+    uint64_t paced;
+    uint64_t overshoot_total;
+    uint64_t overshoot_max;
+    // Whole frame loop iteration and display present, see above
+    uint64_t frame_hist[CHIP8E_STATS_BUCKETS];
+    uint64_t present_hist[CHIP8E_STATS_BUCKETS];
+
+    // chip8_state_t, and where the machine stopped if it is not running
+    uint32_t state;
+    uint16_t PC;
+    uint16_t opcode;
+
+    // Writer bookkeeping for ips
+    uint64_t ips_since;
+    uint64_t ips_instructions;
+} chip8_stats_t, *chip8_stats_p;
+
+uint64_t chip8_stats_now(void);
+
+// Writer: create and map the segment for this process, NULL on failure
+chip8_stats_p chip8_stats_open(const char *rom);
+// Unmap, and remove the segment unless keep is set
+void chip8_stats_close(chip8_stats_p stats, bool keep);
+// Count one frame; present is 0 when nothing was drawn, overshoot is
+// negative for a dropped frame and CHIP8E_STATS_UNPACED when the frame
+// was not paced at all
+void chip8_stats_frame(chip8_stats_p stats, chip8_p chip, uint64_t frame,
+    uint64_t present, int64_t overshoot);
+// Final machine state
+void chip8_stats_state(chip8_stats_p stats, chip8_p chip);
+
+// Reader: map the segment of pid read only, NULL if there is none
+const chip8_stats_t *chip8_stats_attach(int pid);
+void chip8_stats_detach(const chip8_stats_t *stats);
+// Consistent copy of a live segment, fails if the writer holds it too long
+int chip8_stats_snapshot(const chip8_stats_t *stats, chip8_stats_t *copy);
+// Sample below which the given fraction of a histogram lies, us
+uint64_t chip8_stats_percentile(const uint64_t *hist, double fraction);
+
+#endif // __STATS_H
@@ -0,0 +1,220 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "chip8.h"
+#include "stream.h"
+
+static int chip8_stream_nonblock(int fd)
+{
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+        return EXIT_FAILURE;
+    return EXIT_SUCCESS;
+}
+
+int chip8_stream_open(chip8_stream_p stream, const char *path)
+{
+    struct sockaddr_un addr;
+
+    memset(stream, 0x00, sizeof(*stream));
+    stream->fd = -1;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        printf("Socket path too long: %s\n", path);
+        return EXIT_FAILURE;
+    }
+    memset(&addr, 0x00, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    if (fd < 0) {
+        printf("Cannot create socket: %s\n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0
+        || listen(fd, CHIP8E_STREAM_MAX_VIEWERS) < 0
+        || EXIT_SUCCESS != chip8_stream_nonblock(fd)) {
+        printf("Cannot listen on %s: %s\n", path, strerror(errno));
+        close(fd);
+        return EXIT_FAILURE;
+    }
+    stream->fd = fd;
+    strcpy(stream->path, path);
+    return EXIT_SUCCESS;
+}
+
+void chip8_stream_close(chip8_stream_p stream)
+{
+    for (int i = 0; i < stream->viewer_count; i++)
+        close(stream->viewers[i].fd);
+    stream->viewer_count = 0;
+    if (stream->fd >= 0) {
+        close(stream->fd);
+        unlink(stream->path);
+        stream->fd = -1;
+    }
+}
+
+static uint16_t chip8_stream_keys(chip8_stream_p stream)
+{
+    uint16_t keys = 0;
+    for (int i = 0; i < stream->viewer_count; i++)
+        keys |= stream->viewers[i].keys;
+    return keys;
+}
+
+// Swap the viewers' share of the keypad for their current masks,
+// leaving keys pressed locally alone
+static void chip8_stream_update_keys(chip8_stream_p stream, chip8_p chip, uint16_t old)
+{
+    chip->keys = (chip->keys & ~old) | chip8_stream_keys(stream);
+}
+
+static void chip8_stream_drop(chip8_stream_p stream, chip8_p chip, int i)
+{
+    uint16_t old = chip8_stream_keys(stream);
+    close(stream->viewers[i].fd);
+    stream->viewers[i] = stream->viewers[--stream->viewer_count];
+    if (chip)
+        chip8_stream_update_keys(stream, chip, old);
+}
+
+void chip8_stream_poll(chip8_stream_p stream, chip8_p chip)
+{
+    int fd;
+    while ((fd = accept(stream->fd, NULL, NULL)) >= 0) {
+        int sndbuf = CHIP8E_STREAM_BACKLOG * CHIP8E_STREAM_MSG_MAX;
+        if (stream->viewer_count == CHIP8E_STREAM_MAX_VIEWERS
+            || EXIT_SUCCESS != chip8_stream_nonblock(fd)) {
+            close(fd);
+            continue;
+        }
+        setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+        chip8_stream_viewer_t *v = &stream->viewers[stream->viewer_count++];
+        v->fd = fd;
+        v->synced = false;
+        v->keys = 0;
+    }
+
+    for (int i = 0; i < stream->viewer_count; i++) {
+        uint8_t msg[CHIP8E_STREAM_KEYS_LEN];
+        ssize_t n;
+        while ((n = recv(stream->viewers[i].fd, msg, sizeof(msg), 0)) > 0) {
+            if (n != CHIP8E_STREAM_KEYS_LEN || msg[0] != CHIP8E_STREAM_MSG_KEYS)
+                continue;
+            uint16_t old = chip8_stream_keys(stream);
+            stream->viewers[i].keys = msg[1] << 8 | msg[2];
+            chip8_stream_update_keys(stream, chip, old);
+        }
+        if (0 == n || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+            chip8_stream_drop(stream, chip, i--);
+    }
+}
+
+// Encode frame XORed against base, only the rows that differ
+static size_t chip8_stream_encode(chip8_stream_p stream, uint8_t *msg, uint8_t flags,
+    chip8_stream_frame_t frame, chip8_stream_frame_t base)
+{
+    size_t len = CHIP8E_STREAM_HEADER;
+    uint8_t rows = 0;
+
+    for (int y = 0; y < CHIP8E_YRES; y++) {
+        uint8_t delta[CHIP8E_STREAM_ROW_BYTES];
+        uint8_t any = 0;
+        for (int b = 0; b < CHIP8E_STREAM_ROW_BYTES; b++) {
+            delta[b] = frame[y][b] ^ base[y][b];
+            any |= delta[b];
+        }
+        if (!any)
+            continue;
+        msg[len++] = y;
+        memcpy(msg + len, delta, CHIP8E_STREAM_ROW_BYTES);
+        len += CHIP8E_STREAM_ROW_BYTES;
+        rows++;
+    }
+    msg[0] = CHIP8E_STREAM_MSG_FRAME;
+    msg[1] = flags;
+    msg[2] = stream->frame >> 24;
+    msg[3] = stream->frame >> 16;
+    msg[4] = stream->frame >> 8;
+    msg[5] = stream->frame;
+    msg[6] = rows;
+    return len;
+}
+
+void chip8_stream_publish(chip8_stream_p stream, chip8_p chip)
+{
+    static chip8_stream_frame_t blank;
+    chip8_stream_frame_t frame;
+    uint8_t delta[CHIP8E_STREAM_MSG_MAX], key[CHIP8E_STREAM_MSG_MAX];
+    size_t delta_len = 0, key_len = 0;
+
+    // Pack the one byte per pixel video buffer, MSB leftmost
+    memset(frame, 0x00, sizeof(frame));
+    for (int y = 0; y < CHIP8E_YRES; y++)
+        for (int x = 0; x < CHIP8E_XRES; x++)
+            if (chip->video_buffer[y * CHIP8E_XRES + x])
+                frame[y][x >> 3] |= 0x80 >> (x & 0x7);
+
+    stream->frame++;
+    for (int i = 0; i < stream->viewer_count; i++) {
+        chip8_stream_viewer_t *v = &stream->viewers[i];
+        const uint8_t *msg;
+        size_t len;
+
+        if (v->synced) {
+            if (0 == delta_len)
+                delta_len = chip8_stream_encode(stream, delta, 0, frame, stream->prev);
+            // Nothing changed
+            if (CHIP8E_STREAM_HEADER == delta_len)
+                continue;
+            msg = delta;
+            len = delta_len;
+        } else {
+            if (0 == key_len)
+                key_len = chip8_stream_encode(stream, key, CHIP8E_STREAM_KEYFRAME,
+                    frame, blank);
+            msg = key;
+            len = key_len;
+        }
+
+        if (send(v->fd, msg, len, MSG_DONTWAIT | MSG_NOSIGNAL) != (ssize_t)len) {
+            // Full buffer or gone, either way the viewer has lost sync
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                stream->dropped++;
+            chip8_stream_drop(stream, chip, i--);
+            continue;
+        }
+        v->synced = true;
+    }
+    memcpy(stream->prev, frame, sizeof(frame));
+}
+
+int chip8_stream_apply(chip8_stream_frame_t frame, const uint8_t *msg, size_t len)
+{
+    if (len < CHIP8E_STREAM_HEADER || msg[0] != CHIP8E_STREAM_MSG_FRAME)
+        return -1;
+    uint8_t rows = msg[6];
+    if (len != CHIP8E_STREAM_HEADER + (size_t)rows * (1 + CHIP8E_STREAM_ROW_BYTES))
+        return -1;
+    if (msg[1] & CHIP8E_STREAM_KEYFRAME)
+        memset(frame, 0x00, sizeof(chip8_stream_frame_t));
+
+    msg += CHIP8E_STREAM_HEADER;
+    for (int r = 0; r < rows; r++, msg += 1 + CHIP8E_STREAM_ROW_BYTES) {
+        if (msg[0] >= CHIP8E_YRES)
+            return -1;
+        for (int b = 0; b < CHIP8E_STREAM_ROW_BYTES; b++)
+            frame[msg[0]][b] ^= msg[1 + b];
+    }
+    return rows;
+}
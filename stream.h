@@ -0,0 +1,78 @@
+#ifndef __STREAM_H
+#define __STREAM_H
+
+#include "chip8.h"
+
+/**
+ * Frame streaming over a Unix domain socket.
+ *
+ * The server listens on a SOCK_SEQPACKET socket, so every frame is one
+ * message that is queued whole or not at all. A frame message carries
+ * only the rows that changed, each XORed against the previous frame:
+ *
+ *   byte 0      - CHIP8E_STREAM_MSG_FRAME
+ *   byte 1      - flags, CHIP8E_STREAM_KEYFRAME when the rows are XORed
+ *                 against a blank screen rather than the previous frame
+ *   byte 2..5   - frame number, MSB first
+ *   byte 6      - number of rows that follow
+ *   per row     - row index, then CHIP8E_STREAM_ROW_BYTES bytes of pixels,
+ *                 MSB is the leftmost
+ *
+ * A frame is encoded once, the same message goes to every viewer. A new
+ * viewer first gets a key frame, encoded once for all viewers that joined
+ * during the same frame. Sends never block: a viewer whose socket buffer
+ * is full has missed a delta and is dropped.
+ *
+ * Viewers send CHIP8E_STREAM_MSG_KEYS followed by their keypad mask, MSB
+ * first. The machine's keypad is the OR of all viewers' masks.
+ **/
+
+#define CHIP8E_STREAM_MSG_FRAME 'F'
+#define CHIP8E_STREAM_MSG_KEYS  'K'
+#define CHIP8E_STREAM_KEYFRAME  0x01
+
+#define CHIP8E_STREAM_ROW_BYTES (CHIP8E_XRES / 8)
+#define CHIP8E_STREAM_HEADER 7
+#define CHIP8E_STREAM_MSG_MAX \
+    (CHIP8E_STREAM_HEADER + CHIP8E_YRES * (1 + CHIP8E_STREAM_ROW_BYTES))
+#define CHIP8E_STREAM_KEYS_LEN 3
+
+#define CHIP8E_STREAM_MAX_VIEWERS 16
+// Frames a viewer may fall behind before it is dropped, roughly; the
+// kernel also counts its own overhead against the socket buffer
+#define CHIP8E_STREAM_BACKLOG 32
+
+typedef uint8_t chip8_stream_frame_t[CHIP8E_YRES][CHIP8E_STREAM_ROW_BYTES];
+
+typedef struct {
+    int fd;
+    // Has been sent a key frame, deltas apply
+    bool synced;
+    uint16_t keys;
+} chip8_stream_viewer_t;
+
+typedef struct {
+    int fd;
+    char path[108];
+    uint32_t frame;
+    // Frame the last delta was taken against
+    chip8_stream_frame_t prev;
+    int viewer_count;
+    chip8_stream_viewer_t viewers[CHIP8E_STREAM_MAX_VIEWERS];
+    // Viewers dropped for falling behind
+    uint64_t dropped;
+} chip8_stream_t, *chip8_stream_p;
+
+// Listen on path, replacing a stale socket file
+int chip8_stream_open(chip8_stream_p stream, const char *path);
+void chip8_stream_close(chip8_stream_p stream);
+// Accept viewers and apply their keypad input, never blocks
+void chip8_stream_poll(chip8_stream_p stream, chip8_p chip);
+// Send the changes since the last call to every viewer
+void chip8_stream_publish(chip8_stream_p stream, chip8_p chip);
+
+// Viewer side: apply a frame message, returns the number of changed rows
+// or -1 for a malformed message
+int chip8_stream_apply(chip8_stream_frame_t frame, const uint8_t *msg, size_t len);
+
+#endif // __STREAM_H
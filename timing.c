@@ -0,0 +1,146 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "chip8.h"
+#include "timing.h"
+#include "watchdog.h"
+
+void chip8_timing_init(chip8_p chip, chip8_timing_t model, uint32_t ips)
+{
+    chip->timing = model;
+    chip->cycles = 0;
+    chip->frames = 0;
+    switch (model) {
+        case CHIP8E_TIMING_VIP:
+            chip->frame_cycles = CHIP8E_VIP_FRAME_CYCLES;
+        break;
+        case CHIP8E_TIMING_FIXED:
+            // Charged CHIP8E_FRAME_HZ per instruction, so that a frame of
+            // ips cycles holds exactly ips / 60 instructions on average
+            chip->frame_cycles = ips ? ips : CHIP8E_FIXED_IPS_DEFAULT;
+        break;
+        default:
+            chip->frame_cycles = 0;
+        break;
+    }
+    chip->next_frame = chip->frame_cycles;
+}
+
+// 60 Hz timer interrupt
+static void chip8_timing_interrupt(chip8_p chip)
+{
+    if (chip->DT > 0)
+        chip->DT--;
+    if (chip->ST > 0)
+        chip->ST--;
+    chip->frames++;
+    chip->next_frame += chip->frame_cycles;
+    if (chip->timing == CHIP8E_TIMING_VIP)
+        chip->cycles += CHIP8E_VIP_INTERRUPT_CYCLES;
+    // Due for a hang check on the next cycle, see watchdog.h
+    if (chip->watchdog && chip->frames >= chip->watchdog->frame)
+        chip->watchdog->next = chip->instructions;
+}
+
+static bool chip8_timing_skips(chip8_p chip, uint16_t cmd)
+{
+    uint8_t vx = chip->V[CHIP8_INSTR_R1(cmd)];
+    uint8_t vy = chip->V[CHIP8_INSTR_R2(cmd)];
+
+    switch (CHIP8_INSTR_CMD(cmd)) {
+        case 0x3: return vx == CHIP8_INSTR_BYTE(cmd);
+        case 0x4: return vx != CHIP8_INSTR_BYTE(cmd);
+        case 0x5: return vx == vy;
+        case 0x9: return vx != vy;
+        case 0xE:
+            if (CHIP8_INSTR_BYTE(cmd) == 0x9E)
+                return (chip->keys & CHIP8E_KEY_BIT(vx)) != 0;
+            return (chip->keys & CHIP8E_KEY_BIT(vx)) == 0;
+    }
+    return false;
+}
+
+// VIP machine cycles of cmd, without fetch and decode
+static uint32_t chip8_timing_vip_cost(chip8_p chip, uint16_t cmd)
+{
+    uint8_t x = CHIP8_INSTR_R1(cmd);
+
+    switch (CHIP8_INSTR_CMD(cmd)) {
+        case 0x0:
+            if (0x00E0 == cmd)
+                return 3024;
+            if (0x00EE == cmd)
+                return 10;
+            return 10;
+        case 0x1: return 12;
+        case 0x2: return 26;
+        case 0x3:
+        case 0x4:
+        case 0x5:
+        case 0x9:
+        case 0xE:
+            return chip8_timing_skips(chip, cmd) ? 18 : 14;
+        case 0x6: return 6;
+        case 0x7: return 10;
+        case 0x8: return 44;
+        case 0xA: return 12;
+        case 0xB: return 22;
+        case 0xC: return 36;
+        case 0xD: {
+            // Unaligned sprites are shifted across two bytes per row
+            uint32_t row = (chip->V[x] & 0x7) ? 46 : 34;
+            return 26 + CHIP8_INSTR_NIBBLE(cmd) * row;
+        }
+        case 0xF:
+            switch (CHIP8_INSTR_BYTE(cmd)) {
+                case 0x33: {
+                    // Digits are found by repeated subtraction
+                    uint8_t n = chip->V[x];
+                    return 80 + 16 * (n / 100 + (n / 10) % 10 + n % 10);
+                }
+                case 0x55:
+                case 0x65:
+                    return 14 + 14 * (x + 1);
+                case 0x1E:
+                case 0x29:
+                    return 16;
+                case 0x0A:
+                    return 20;
+                default:
+                    return 10;
+            }
+    }
+    return 10;
+}
+
+void chip8_timing_account(chip8_p chip, uint16_t cmd)
+{
+    switch (chip->timing) {
+        case CHIP8E_TIMING_VIP:
+            if (CHIP8_INSTR_CMD(cmd) == 0xD) {
+                // Wait for vblank, then draw
+                if (chip->cycles < chip->next_frame)
+                    chip->cycles = chip->next_frame;
+                while (chip->cycles >= chip->next_frame)
+                    chip8_timing_interrupt(chip);
+            }
+            chip->cycles += CHIP8E_VIP_FETCH_CYCLES + chip8_timing_vip_cost(chip, cmd);
+        break;
+        case CHIP8E_TIMING_FIXED:
+            chip->cycles += CHIP8E_FRAME_HZ;
+        break;
+        default:
+            return;
+    }
+    while (chip->cycles >= chip->next_frame)
+        chip8_timing_interrupt(chip);
+}
+
+double chip8_timing_seconds(chip8_p chip)
+{
+    if (0 == chip->frame_cycles)
+        return 0.0;
+    return (double)chip->cycles / ((double)chip->frame_cycles * CHIP8E_FRAME_HZ);
+}
@@ -0,0 +1,46 @@
+#ifndef __TIMING_H
+#define __TIMING_H
+
+#include "chip8.h"
+
+/**
+ * Emulated time.
+ *
+ * Every instruction is charged a number of cycles before it executes.
+ * Each time the count passes a frame boundary the 60 Hz interrupt runs:
+ * DT and ST count down and chip->frames advances. Frontends pace on
+ * chip->frames, so game speed and timers follow the same clock.
+ *
+ * CHIP8E_TIMING_VIP charges COSMAC VIP machine cycles per opcode class,
+ * following the cost of the routines in the VIP interpreter. Skips that
+ * are taken cost more, DRW depends on the sprite height and alignment and
+ * first waits for the next interrupt, as the VIP waits for vblank before
+ * drawing. The figures are approximations of the original, not a
+ * cycle exact replay.
+ *
+ * CHIP8E_TIMING_FIXED runs ips instructions per emulated second, with no
+ * regard to what they are.
+ *
+ * CHIP8E_TIMING_NONE charges nothing, the host ticks the timers itself.
+ **/
+
+#define CHIP8E_FRAME_HZ 60
+
+// VIP: 1.76064 MHz clock, 8 clocks per machine cycle
+#define CHIP8E_VIP_CYCLES_PER_SEC 220080
+#define CHIP8E_VIP_FRAME_CYCLES (CHIP8E_VIP_CYCLES_PER_SEC / CHIP8E_FRAME_HZ)
+// Interrupt routine and display DMA, lost to the interpreter every frame
+#define CHIP8E_VIP_INTERRUPT_CYCLES 1832
+// Fetch and decode, paid by every instruction
+#define CHIP8E_VIP_FETCH_CYCLES 40
+
+#define CHIP8E_FIXED_IPS_DEFAULT 700
+
+// Select the model, ips only matters for CHIP8E_TIMING_FIXED
+void chip8_timing_init(chip8_p chip, chip8_timing_t model, uint32_t ips);
+// Charge cmd and run the interrupts that became due
+void chip8_timing_account(chip8_p chip, uint16_t cmd);
+// Emulated seconds since chip8_timing_init()
+double chip8_timing_seconds(chip8_p chip);
+
+#endif // __TIMING_H
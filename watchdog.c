@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "chip8.h"
+#include "watchdog.h"
+
+static const char *reasons[] = { "running", "halted", "hung", "trapped", "budget exhausted" };
+
+static void chip8_watchdog_schedule(chip8_p chip, chip8_watchdog_p wd)
+{
+    wd->next = chip->instructions + CHIP8E_WATCHDOG_INTERVAL;
+    wd->frame = chip->frames + CHIP8E_WATCHDOG_FRAMES;
+    if (wd->budget && wd->next > wd->budget)
+        wd->next = wd->budget;
+}
+
+void chip8_watchdog_attach(chip8_p chip, chip8_watchdog_p wd, uint64_t budget)
+{
+    memset(wd, 0x00, sizeof(*wd));
+    wd->budget = budget;
+    wd->lambda = wd->power = 1;
+    chip8_watchdog_schedule(chip, wd);
+    chip->watchdog = wd;
+}
+
+void chip8_watchdog_detach(chip8_p chip)
+{
+    chip->watchdog = NULL;
+}
+
+void chip8_watchdog_stop(chip8_p chip, chip8_exit_reason_t reason)
+{
+    if (chip->watchdog)
+        chip->watchdog->reason = reason;
+    chip->state = CHIP_STATE_EXIT;
+}
+
+uint64_t chip8_state_hash(chip8_p chip)
+{
+    struct {
+        uint16_t stack[CHIP8E_STACK_SIZE];
+        uint8_t V[16];
+        uint16_t I, PC, keys;
+        uint8_t SP, DT, ST, pad;
+        // RND state, what RND returns next
+        unsigned int seed;
+        uint64_t phase;
+    } regs;
+
+    // Padding must hash the same every time
+    memset(&regs, 0x00, sizeof(regs));
+    memcpy(regs.stack, chip->stack, sizeof(regs.stack));
+    memcpy(regs.V, chip->V, sizeof(regs.V));
+    regs.I = chip->I;
+    regs.PC = CHIP8E_MEM_MASK(chip->PC);
+    regs.keys = chip->keys;
+    regs.SP = chip->SP;
+    regs.DT = chip->DT;
+    regs.ST = chip->ST;
+    regs.seed = chip->seed;
+    regs.phase = chip->timing ? chip->next_frame - chip->cycles : 0;
+
+    uint64_t h = chip8_hash(chip->memory, sizeof(chip->memory));
+    h = (h ^ chip8_hash(chip->video_buffer, sizeof(chip->video_buffer))) * 0x9E3779B97F4A7C15ULL;
+    h = (h ^ chip8_hash(&regs, sizeof(regs))) * 0x9E3779B97F4A7C15ULL;
+    return h;
+}
+
+bool chip8_watchdog_check(chip8_p chip)
+{
+    chip8_watchdog_p wd = chip->watchdog;
+    uint16_t pc = CHIP8E_MEM_MASK(chip->PC);
+
+    chip8_watchdog_schedule(chip, wd);
+    if (wd->budget && chip->instructions >= wd->budget) {
+        chip8_watchdog_stop(chip, CHIP8E_EXIT_BUDGET);
+        return true;
+    }
+    if ((chip->memory[pc] << 8 | chip->memory[CHIP8E_MEM_MASK(pc + 1)]) == (0x1000 | pc)) {
+        chip8_watchdog_stop(chip, CHIP8E_EXIT_HALTED);
+        return true;
+    }
+
+    uint64_t h = chip8_state_hash(chip);
+    if (wd->checks && h == wd->saved) {
+        wd->period = wd->lambda;
+        chip8_watchdog_stop(chip, CHIP8E_EXIT_HUNG);
+        return true;
+    }
+    if (wd->lambda == wd->power) {
+        wd->saved = h;
+        wd->power <<= 1;
+        wd->lambda = 0;
+    }
+    wd->lambda++;
+    wd->checks++;
+    return false;
+}
+
+chip8_exit_reason_t chip8_watchdog_reason(chip8_p chip)
+{
+    if (chip->watchdog && chip->watchdog->reason != CHIP8E_EXIT_RUNNING)
+        return chip->watchdog->reason;
+    if (chip->state == CHIP_STATE_EXCEPTION)
+        return CHIP8E_EXIT_TRAPPED;
+    return CHIP8E_EXIT_RUNNING;
+}
+
+const char *chip8_exit_name(chip8_exit_reason_t reason)
+{
+    return (reason < CHIP8E_EXIT_REASONS) ? reasons[reason] : "?";
+}
@@ -0,0 +1,73 @@
+#ifndef __WATCHDOG_H
+#define __WATCHDOG_H
+
+#include "chip8.h"
+
+/**
+ * Stops runs that cannot make progress.
+ *
+ * Once attached, chip8_cycle() hands over to the watchdog every
+ * CHIP8E_WATCHDOG_FRAMES frames of emulated time, or every
+ * CHIP8E_WATCHDOG_INTERVAL instructions if that comes first or the
+ * machine has no clock. Both count from the previous check, so the state
+ * at one check decides the state at the next. A check stops the machine
+ * (CHIP_STATE_EXIT) when:
+ *  - PC is on a JP to itself, the usual way a program ends (halted);
+ *  - the whole machine state seen at the checks repeats (hung). The
+ *    checks hash memory, display, registers, stack, timers, keys, the RND
+ *    seed and the phase of the 60 Hz clock and look for a cycle in that
+ *    sequence with Brent's algorithm, so a loop is found within a few
+ *    multiples of its length plus the run up to it, in constant memory.
+ *    A repeat can only be broken from outside the machine, by a new key.
+ *    A loop that keeps drawing random numbers never repeats and runs to
+ *    the budget;
+ *  - the instruction budget is spent (budget).
+ * Exceptions, including stack overflow and underflow, stop the machine
+ * on their own and are reported as trapped.
+ *
+ * Only meant for unattended runs: a game waiting for a key on its title
+ * screen is hung as far as the watchdog can tell.
+ **/
+
+#define CHIP8E_WATCHDOG_FRAMES 60
+#define CHIP8E_WATCHDOG_INTERVAL 65536
+
+typedef enum {
+    CHIP8E_EXIT_RUNNING,
+    CHIP8E_EXIT_HALTED,
+    CHIP8E_EXIT_HUNG,
+    CHIP8E_EXIT_TRAPPED,
+    CHIP8E_EXIT_BUDGET,
+    CHIP8E_EXIT_REASONS
+} chip8_exit_reason_t;
+
+typedef struct chip8_watchdog {
+    // Instructions to run, 0 for no limit
+    uint64_t budget;
+    // Instruction count and frame of the next check
+    uint64_t next;
+    uint64_t frame;
+    // Brent: saved hash, checks since it was saved and the power of two
+    // after which it is replaced
+    uint64_t saved;
+    uint64_t lambda;
+    uint64_t power;
+    // Checks done, and the length of the cycle found, in checks
+    uint64_t checks;
+    uint64_t period;
+    chip8_exit_reason_t reason;
+} chip8_watchdog_t, *chip8_watchdog_p;
+
+void chip8_watchdog_attach(chip8_p chip, chip8_watchdog_p wd, uint64_t budget);
+void chip8_watchdog_detach(chip8_p chip);
+// Called by chip8_cycle(), true if the machine was stopped
+bool chip8_watchdog_check(chip8_p chip);
+// Why the machine stopped, also after an exception or a stop from outside
+chip8_exit_reason_t chip8_watchdog_reason(chip8_p chip);
+// Stop the machine for a reason found outside the core, a frame budget
+void chip8_watchdog_stop(chip8_p chip, chip8_exit_reason_t reason);
+const char *chip8_exit_name(chip8_exit_reason_t reason);
+// Hash of everything that decides what the machine does next
+uint64_t chip8_state_hash(chip8_p chip);
+
+#endif // __WATCHDOG_H